@@ -0,0 +1,217 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace heurohash {
+/*
+ * Value type for maps updated concurrently (e.g. counters & run-time tunable
+ * thresholds hit from many threads). Used as a map's value type (see the
+ * atomic_* aliases next to each map), it makes every value access atomic,
+ * while the keys stay immutable - lookups remain lock-free & only the value
+ * accesses synchronize.
+ *
+ * Values are plain T accessed through std::atomic_ref, so maps can still be
+ * built at compile time (constinit) & spans work unchanged. Assignment (also
+ * used by clear()) is an atomic store, copy construction isn't atomic.
+ */
+template <typename T> class atomic_value {
+    using RefT = std::atomic_ref<T>;
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "atomic_value requires trivially copyable values");
+    static_assert(RefT::is_always_lock_free,
+                  "atomic_value requires lock-free values");
+
+    alignas(RefT::required_alignment) T value{};
+
+    /* Loads don't modify the value, so const maps (& spans) can load too */
+    RefT ref() const noexcept { return RefT{const_cast<T &>(value)}; }
+
+  public:
+    using value_type = T;
+
+    constexpr atomic_value() noexcept = default;
+    constexpr atomic_value(T desired) noexcept : value{desired} {}
+
+    constexpr atomic_value(const atomic_value &) noexcept = default;
+    constexpr atomic_value &operator=(const atomic_value &other) noexcept {
+        store(other.load());
+        return *this;
+    }
+
+    constexpr T operator=(T desired) noexcept {
+        store(desired);
+        return desired;
+    }
+
+    constexpr operator T() const noexcept { return load(); }
+
+    constexpr T
+    load(std::memory_order order = std::memory_order_seq_cst) const noexcept {
+        if (std::is_constant_evaluated()) {
+            return value;
+        }
+        return ref().load(order);
+    }
+
+    constexpr void
+    store(T desired,
+          std::memory_order order = std::memory_order_seq_cst) noexcept {
+        if (std::is_constant_evaluated()) {
+            value = desired;
+        } else {
+            ref().store(desired, order);
+        }
+    }
+
+    constexpr T
+    exchange(T desired,
+             std::memory_order order = std::memory_order_seq_cst) noexcept {
+        if (std::is_constant_evaluated()) {
+            auto old = value;
+            value = desired;
+            return old;
+        }
+        return ref().exchange(desired, order);
+    }
+
+    constexpr bool compare_exchange_weak(T &expected, T desired,
+                                         std::memory_order success,
+                                         std::memory_order failure) noexcept {
+        if (std::is_constant_evaluated()) {
+            return compare_exchange_constant(expected, desired);
+        }
+        return ref().compare_exchange_weak(expected, desired, success,
+                                           failure);
+    }
+
+    constexpr bool compare_exchange_weak(
+        T &expected, T desired,
+        std::memory_order order = std::memory_order_seq_cst) noexcept {
+        if (std::is_constant_evaluated()) {
+            return compare_exchange_constant(expected, desired);
+        }
+        return ref().compare_exchange_weak(expected, desired, order);
+    }
+
+    constexpr bool compare_exchange_strong(T &expected, T desired,
+                                           std::memory_order success,
+                                           std::memory_order failure) noexcept {
+        if (std::is_constant_evaluated()) {
+            return compare_exchange_constant(expected, desired);
+        }
+        return ref().compare_exchange_strong(expected, desired, success,
+                                             failure);
+    }
+
+    constexpr bool compare_exchange_strong(
+        T &expected, T desired,
+        std::memory_order order = std::memory_order_seq_cst) noexcept {
+        if (std::is_constant_evaluated()) {
+            return compare_exchange_constant(expected, desired);
+        }
+        return ref().compare_exchange_strong(expected, desired, order);
+    }
+
+    constexpr T
+    fetch_add(T arg,
+              std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+    {
+        if (std::is_constant_evaluated()) {
+            return std::exchange(value, static_cast<T>(value + arg));
+        }
+        return ref().fetch_add(arg, order);
+    }
+
+    constexpr T
+    fetch_sub(T arg,
+              std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+    {
+        if (std::is_constant_evaluated()) {
+            return std::exchange(value, static_cast<T>(value - arg));
+        }
+        return ref().fetch_sub(arg, order);
+    }
+
+    constexpr T
+    fetch_and(T arg,
+              std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires(std::is_integral_v<T> && !std::is_same_v<T, bool>)
+    {
+        if (std::is_constant_evaluated()) {
+            return std::exchange(value, static_cast<T>(value & arg));
+        }
+        return ref().fetch_and(arg, order);
+    }
+
+    constexpr T
+    fetch_or(T arg,
+             std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires(std::is_integral_v<T> && !std::is_same_v<T, bool>)
+    {
+        if (std::is_constant_evaluated()) {
+            return std::exchange(value, static_cast<T>(value | arg));
+        }
+        return ref().fetch_or(arg, order);
+    }
+
+    constexpr T
+    fetch_xor(T arg,
+              std::memory_order order = std::memory_order_seq_cst) noexcept
+        requires(std::is_integral_v<T> && !std::is_same_v<T, bool>)
+    {
+        if (std::is_constant_evaluated()) {
+            return std::exchange(value, static_cast<T>(value ^ arg));
+        }
+        return ref().fetch_xor(arg, order);
+    }
+
+  private:
+    constexpr bool compare_exchange_constant(T &expected, T desired) noexcept {
+        if (value == expected) {
+            value = desired;
+            return true;
+        }
+        expected = value;
+        return false;
+    }
+};
+
+/* Aligned for std::atomic_ref, but no bigger than T */
+static_assert(sizeof(atomic_value<int>) == sizeof(int));
+static_assert(alignof(atomic_value<std::uint64_t>) ==
+              std::atomic_ref<std::uint64_t>::required_alignment);
+
+/* Constant evaluation uses plain accesses, with the same results */
+static_assert([] {
+    atomic_value<int> value{5};
+    auto const old = value.exchange(7);
+    auto expected = 5;
+    auto const failed = value.compare_exchange_strong(expected, 9);
+    auto const swapped = value.compare_exchange_weak(expected, 9);
+    return old == 5 && !failed && expected == 7 && swapped &&
+           value.load() == 9;
+}());
+static_assert([] {
+    atomic_value<unsigned> value{0b1100};
+    auto const add = value.fetch_add(3);
+    auto const sub = value.fetch_sub(1);
+    auto const and_ = value.fetch_and(0b1010);
+    auto const or_ = value.fetch_or(0b0001);
+    auto const xor_ = value.fetch_xor(0b1000);
+    return add == 0b1100 && sub == 0b1111 && and_ == 0b1110 &&
+           or_ == 0b1010 && xor_ == 0b1011 && value == 0b0011;
+}());
+static_assert([] {
+    atomic_value<double> value;
+    value = 1.5;
+    atomic_value<double> copy{value};
+    copy.fetch_add(1.0);
+    value = copy;
+    return value.load() == 2.5;
+}());
+} // namespace heurohash
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "traits.hpp"
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <iterator>
+#include <type_traits>
 
 namespace heurohash::detail {
 template <class ForwardIt, class T, typename Func>
@@ -20,8 +23,21 @@ branchless_lower_bound(ForwardIt first, ForwardIt last, const T &value,
     return first;
 }
 
-template <typename KeyT, typename Func>
-static constexpr size_t ordered_find_impl(const KeyT *keys, size_t size,
+/* First element that value is less than (comp_func order) */
+template <class ForwardIt, class T, typename Func>
+static constexpr ForwardIt
+branchless_upper_bound(ForwardIt first, ForwardIt last, const T &value,
+                       const Func &comp_func) {
+    return branchless_lower_bound(first, last, value,
+                                  [&](const auto &elem, const auto &val) {
+                                      return !comp_func(val, elem);
+                                  });
+}
+
+/* KeyIt is a pointer or random access iterator to the sorted keys (see
+ * packed_key_iterator) */
+template <typename KeyIt, typename KeyT, typename Func>
+static constexpr size_t ordered_find_impl(KeyIt keys, size_t size,
                                           const KeyT &key,
                                           const Func &comp_func) noexcept {
     /* branchless ~3x faster on 5900x */
@@ -34,6 +50,65 @@ static constexpr size_t ordered_find_impl(const KeyT *keys, size_t size,
     return size;
 }
 
+/* Lower bounds of several keys at once. Branchless lower bound runs the same
+ * number of steps for every key (only depends on size), so a group of
+ * searches is advanced in lockstep & the next probe of each is prefetched
+ * before moving to the others. That way the group's cache misses overlap
+ * instead of every step of every search waiting on its own miss.
+ * Calls emit(input_idx, lower_bound_idx) for every key */
+inline constexpr size_t lower_bound_group_size = 16;
+
+/* Prefetches the key at it, through base() if it isn't a plain pointer */
+template <typename KeyIt> static void prefetch_key(KeyIt it) noexcept {
+    if constexpr (std::is_pointer_v<KeyIt>) {
+        __builtin_prefetch(it);
+    } else if constexpr (requires { it.base(); }) {
+        __builtin_prefetch(it.base());
+    }
+}
+
+template <typename KeyIt, typename KeyT, typename Func, typename Emit>
+static constexpr void
+branchless_lower_bound_many(KeyIt keys, size_t size, const KeyT *in,
+                            size_t count, const Func &comp_func,
+                            Emit &&emit) noexcept {
+    std::array<size_t, lower_bound_group_size> firsts{};
+    for (size_t base = 0; base < count; base += lower_bound_group_size) {
+        auto const group = std::min(lower_bound_group_size, count - base);
+        std::fill(firsts.begin(), firsts.end(), size_t{0});
+        auto length = size;
+        while (length > 0) {
+            auto half = length / 2;
+            for (size_t i = 0; i < group; ++i) {
+                /* Multiply instead of select, otherwise GCC emits a branch */
+                firsts[i] += (length - half) *
+                             static_cast<size_t>(comp_func(
+                                 keys[firsts[i] + half], in[base + i]));
+                if (!std::is_constant_evaluated()) {
+                    prefetch_key(keys + firsts[i] + half / 2);
+                }
+            }
+            length = half;
+        }
+        for (size_t i = 0; i < group; ++i) {
+            emit(base + i, firsts[i]);
+        }
+    }
+}
+
+/* Batched ordered_find_impl, emit(input_idx, idx) with idx == size if the key
+ * is missing */
+template <typename KeyIt, typename KeyT, typename Func, typename Emit>
+static constexpr void ordered_find_many_impl(KeyIt keys, size_t size,
+                                             const KeyT *in, size_t count,
+                                             const Func &comp_func,
+                                             Emit &&emit) noexcept {
+    branchless_lower_bound_many(
+        keys, size, in, count, comp_func, [&](size_t i, size_t idx) {
+            emit(i, (idx != size && keys[idx] == in[i]) ? idx : size);
+        });
+}
+
 /* The reason we use a callable instead of a comparison type, is because it
  * offers more opportunities for identical code folding without specifying icf
  * in the linker. Take for example find of enum A & B. By using Compare we have
@@ -42,20 +117,23 @@ static constexpr size_t ordered_find_impl(const KeyT *keys, size_t size,
  * calls the actual types comparison function, the compiler will very likely
  * fold the two different lambdas into the same instanciation (assuming that
  * they are otherwise identical, apart from the 'real' type) */
-template <typename KeyT, typename Compare>
+template <typename KeyIt, typename KeyT, typename Compare>
 static constexpr size_t
-ordered_find_impl_cast(const KeyT *keys, size_t size, const KeyT &key,
+ordered_find_impl_cast(KeyIt keys, size_t size, const KeyT &key,
                        const Compare &compare) noexcept {
     using KeyUnderlyingT = detail::underlying_type<KeyT>;
     if constexpr (std::is_same_v<KeyT, KeyUnderlyingT>) {
         /* Can just pass comparison since underlying & real type is same */
         return detail::ordered_find_impl(keys, size, key, compare);
+    } else if constexpr (!std::is_pointer_v<KeyIt>) {
+        /* Keys are decoded by the iterator, nothing to reinterpret */
+        return detail::ordered_find_impl(keys, size, key, compare);
     } else if (std::is_constant_evaluated()) {
         /* constant eval won't allow reinterpret_cast */
         return detail::ordered_find_impl(keys, size, key, compare);
     } else if constexpr (std::is_empty_v<Compare>) {
         /* If empty, we can capture nothing in the lambda */
-        return detail::ordered_find_impl<KeyUnderlyingT>(
+        return detail::ordered_find_impl(
             reinterpret_cast<const KeyUnderlyingT *>(keys), size,
             static_cast<KeyUnderlyingT>(key), [](const auto &a, const auto &b) {
                 return Compare{}(static_cast<KeyT>(a), static_cast<KeyT>(b));
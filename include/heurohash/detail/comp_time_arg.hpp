@@ -2,6 +2,11 @@
 
 #include <concepts>
 
+/// Always false, but dependent on T, so that a static_assert using it only
+/// fires once the branch containing it is instantiated (static_assert(false)
+/// is rejected eagerly before C++23/P2593)
+template <typename T> inline constexpr bool comp_time_dependent_false = false;
+
 template <typename T>
 concept comp_time = requires {
     []() constexpr {
@@ -29,8 +34,9 @@ concept comp_time_with_arg = requires {
                              }) {
             return T::operator()();
         } else {
-            static_assert(false, "Type does not have a callable operator() "
-                                 "returning the required type.");
+            static_assert(comp_time_dependent_false<T>,
+                          "Type does not have a callable operator() "
+                          "returning the required type.");
         }
     }();
 };
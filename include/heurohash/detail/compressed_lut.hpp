@@ -0,0 +1,116 @@
+#pragma once
+
+/*
+ * Compressed representations of the pseudo-pext lookup table.
+ *
+ * The dense LUT holds a bucket start index for every possible hash value, and
+ * many of those slots are unused. These trade a couple of extra instructions
+ * per lookup for a (much) smaller table:
+ *  - bit_packed_lut: every slot takes exactly bit_width(N - 1) bits
+ *  - rank_lut: only the used slots are stored, the hash is mapped onto them by
+ *    an occupancy bitmap & per-word rank
+ *
+ * Unused slots read as 0, same as in the dense LUT (the probe then just
+ * doesn't find the key).
+ */
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace lookup {
+
+/* LUT representation policies for pseudo_pext_lookup */
+struct dense_lut_policy {};
+struct bit_packed_lut_policy {};
+struct rank_lut_policy {};
+
+/// Slots LUT entries, all of them < Size
+template <std::size_t Slots, std::size_t Size> class bit_packed_lut {
+    static constexpr auto entry_bits =
+        static_cast<std::size_t>(std::bit_width(Size > 0 ? Size - 1 : 0));
+    static constexpr auto entry_mask = (std::uint64_t{1} << entry_bits) - 1;
+
+    /* One extra word, so that an entry can always be read from two words */
+    std::array<std::uint64_t, (Slots * entry_bits + 63) / 64 + 1> words{};
+
+  public:
+    using value_type = std::size_t;
+
+    template <typename DenseT>
+    constexpr explicit bit_packed_lut(const DenseT &dense) noexcept {
+        for (auto slot = std::size_t{}; slot < Slots; ++slot) {
+            auto const pos = slot * entry_bits;
+            auto const value = static_cast<std::uint64_t>(dense[slot]);
+            words[pos / 64] |= value << (pos % 64);
+            if ((pos % 64) + entry_bits > 64) {
+                words[pos / 64 + 1] |= value >> (64 - (pos % 64));
+            }
+        }
+    }
+
+    [[nodiscard]] constexpr __attribute__((always_inline)) std::size_t
+    operator[](std::size_t slot) const noexcept {
+        /* A single bucket, every entry is 0 (and words has only one word) */
+        if constexpr (entry_bits == 0) {
+            return 0;
+        }
+        auto const pos = slot * entry_bits;
+        auto const word = pos / 64;
+        auto const offset = pos % 64;
+        /* High part shifted in two steps, so that offset 0 is not UB */
+        auto const bits = (words[word] >> offset) |
+                          ((words[word + 1] << 1U) << (63 - offset));
+        return static_cast<std::size_t>(bits & entry_mask);
+    }
+
+    constexpr std::size_t size() const noexcept { return Slots; }
+};
+
+/// Slots LUT entries, only Used of them are stored (as EntryT)
+/// RankT must be able to hold Used
+template <std::size_t Slots, std::size_t Used, typename EntryT, typename RankT>
+class rank_lut {
+    static constexpr auto words_v = (Slots + 63) / 64;
+
+    std::array<std::uint64_t, words_v> occupancy{};
+    /* Number of used slots before every occupancy word */
+    std::array<RankT, words_v> ranks{};
+    std::array<EntryT, Used> entries{};
+
+  public:
+    using value_type = std::size_t;
+
+    template <typename DenseT>
+    constexpr rank_lut(
+        const DenseT &dense,
+        const std::array<std::uint64_t, words_v> &used_slots) noexcept
+        : occupancy{used_slots} {
+        auto rank = std::size_t{};
+        for (auto word = std::size_t{}; word < words_v; ++word) {
+            ranks[word] = static_cast<RankT>(rank);
+            for (auto bit = std::size_t{}; bit < 64; ++bit) {
+                if (((occupancy[word] >> bit) & 1U) != 0) {
+                    entries[rank++] =
+                        static_cast<EntryT>(dense[word * 64 + bit]);
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] constexpr __attribute__((always_inline)) std::size_t
+    operator[](std::size_t slot) const noexcept {
+        auto const word = occupancy[slot / 64];
+        auto const bit = slot % 64;
+        if (((word >> bit) & 1U) == 0) {
+            return 0;
+        }
+        auto const below = word & ((std::uint64_t{1} << bit) - 1);
+        return entries[ranks[slot / 64] +
+                       static_cast<std::size_t>(std::popcount(below))];
+    }
+
+    constexpr std::size_t size() const noexcept { return Slots; }
+};
+} // namespace lookup
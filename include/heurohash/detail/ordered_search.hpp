@@ -0,0 +1,584 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <type_traits>
+
+#include "branchless_lower_bound.hpp"
+#include "packed_key_iterator.hpp"
+#include "simd_node_rank.hpp"
+#include "simd_probe.hpp"
+#include "traits.hpp"
+#include "weights.hpp"
+
+/*
+ * Search strategies for ordered_map_keyset. The keyset always keeps its keys
+ * sorted (iteration, spans, value order), a strategy may build an additional
+ * search index over them at compile time.
+ *
+ * Every strategy provides index<KeyT, Size>, which is default constructible,
+ * constructible from the sorted keys & provides
+ * find(sorted_keys, key, compare) -> sorted index (Size if not found) &
+ * searches_sorted_keys, which is true if find needs nothing but the sorted
+ * keys (spans then search those directly, instead of going through the index).
+ * An index may also hold the keys itself (stores_keys<Compare>), the keyset
+ * then drops its copy & iterates the index instead (begin(), end()), finding
+ * through find(key).
+ */
+
+namespace heurohash {
+namespace detail {
+/// Narrowest unsigned type holding [0, Range]
+template <std::uint64_t Range>
+using packed_key_t = std::conditional_t<
+    (Range <= UINT8_MAX), std::uint8_t,
+    std::conditional_t<(Range <= UINT16_MAX), std::uint16_t,
+                       std::conditional_t<(Range <= UINT32_MAX),
+                                          std::uint32_t, std::uint64_t>>>;
+
+/// Type-erased find over a keyset, lets spans reach its search index
+template <typename KeyT>
+using ordered_search_fn = size_t (*)(const void *, const KeyT &);
+
+/// Whether Compare orders keys the same way as their underlying integers
+template <typename KeyT, typename Compare>
+inline constexpr bool is_plain_less_v =
+    std::is_same_v<Compare, std::less<KeyT>> ||
+    std::is_same_v<Compare, std::less<>>;
+
+/// Whether the index holds the keys in place of the keyset
+template <typename IndexT, typename Compare>
+inline constexpr bool index_stores_keys_v = [] {
+    if constexpr (requires { IndexT::template stores_keys<Compare>; }) {
+        return IndexT::template stores_keys<Compare>;
+    } else {
+        return false;
+    }
+}();
+} // namespace detail
+
+/// Branchless lower bound over the sorted keys, the default. No extra storage
+struct sorted_search {
+    template <typename KeyT, size_t Size> struct index {
+        static constexpr bool searches_sorted_keys = true;
+
+        constexpr index() noexcept = default;
+        constexpr explicit index(const std::array<KeyT, Size> &) noexcept {}
+
+        template <typename Compare>
+        constexpr size_t find(const std::array<KeyT, Size> &keys,
+                              const KeyT &key,
+                              const Compare &compare) const noexcept {
+            return detail::ordered_find_impl_cast(keys.data(), Size, key,
+                                                  compare);
+        }
+    };
+};
+
+/// Copy of the keys in Eytzinger (BFS) order, searched by a branchless
+/// descent that prefetches as many levels ahead as there are keys per cache
+/// line (4 for 32-bit keys, where the 16 descendants of a node are adjacent &
+/// line aligned). Much fewer dependent cache misses than a binary search once
+/// the keys don't fit into L1, at the cost of storing the keys twice (+ an
+/// index per key)
+struct eytzinger_search {
+    template <typename KeyT, size_t Size> struct index {
+        static constexpr bool searches_sorted_keys = false;
+
+        using RankT = detail::ordered_index_t<Size>;
+
+        /* Eytzinger order is 1-based, [0] is unused. Line aligned, so the
+         * 2^prefetch_levels descendants of a node (starting at a multiple of
+         * their count) share a line if the key size is a power of 2 */
+        alignas(detail::cache_line_size) std::array<KeyT, Size + 1> keys{};
+        /* Sorted index of every node */
+        std::array<RankT, Size + 1> ranks{};
+
+        static constexpr auto prefetch_levels = static_cast<size_t>(
+            std::bit_width(std::max(detail::cache_line_size / sizeof(KeyT),
+                                    size_t{1})) -
+            1);
+
+        constexpr index() noexcept = default;
+
+        constexpr explicit index(
+            const std::array<KeyT, Size> &sorted) noexcept {
+            /* In-order walk of the implicit tree assigns the sorted keys */
+            auto next = size_t{0};
+            auto fill = [&](auto &self, size_t node) -> void {
+                if (node > Size) {
+                    return;
+                }
+                self(self, 2 * node);
+                keys[node] = sorted[next];
+                ranks[node] = static_cast<RankT>(next++);
+                self(self, 2 * node + 1);
+            };
+            fill(fill, 1);
+        }
+
+        template <typename Compare>
+        constexpr size_t find(const std::array<KeyT, Size> &,
+                              const KeyT &key,
+                              const Compare &compare) const noexcept {
+            auto node = size_t{1};
+            while (node <= Size) {
+                if (prefetch_levels != 0 && !std::is_constant_evaluated()) {
+                    /* Clamped, so the address stays within the keys */
+                    auto const first = node << prefetch_levels;
+                    __builtin_prefetch(keys.data() + std::min(first, Size));
+                    if constexpr (!std::has_single_bit(sizeof(KeyT))) {
+                        /* Descendants may straddle two lines */
+                        auto const last =
+                            first + (size_t{1} << prefetch_levels) - 1;
+                        __builtin_prefetch(keys.data() + std::min(last, Size));
+                    }
+                }
+                node = 2 * node + static_cast<size_t>(compare(keys[node], key));
+            }
+            /* Undo the right turns taken after the last left one */
+            node >>= std::countr_one(node) + 1;
+            if (node != 0 && keys[node] == key) {
+                return ranks[node];
+            }
+            return Size;
+        }
+    };
+};
+
+/// Static B-tree (S-tree) over the keys. Every node is a cache line of keys
+/// with a child per gap, stored in BFS order & searched top-down by counting
+/// the node keys less than the searched one, which is done with vector
+/// compares & popcount for integral (or enum) keys with std::less.
+/// ~log_17(n) dependent loads for 32-bit keys instead of log_2(n), at the cost
+/// of storing the keys twice (+ an index per key)
+struct stree_search {
+    template <typename KeyT, size_t Size> struct index {
+        static constexpr bool searches_sorted_keys = false;
+
+        using RankT = detail::ordered_index_t<Size>;
+        using KeyUnderlyingT = detail::underlying_type<KeyT>;
+
+        static constexpr size_t node_bytes = 64;
+        static constexpr size_t node_keys =
+            std::max(node_bytes / sizeof(KeyT), size_t{2});
+        static constexpr size_t node_count =
+            (Size + node_keys - 1) / node_keys;
+        static constexpr size_t slot_count = node_count * node_keys;
+
+        /* Unused trailing slots repeat the largest key, so every node stays
+         * sorted & they are never the first key >= any searched key */
+        alignas(node_bytes) std::array<KeyT, slot_count> keys{};
+        /* Sorted index of every slot */
+        std::array<RankT, slot_count> ranks{};
+
+        static constexpr auto prefetch_levels = static_cast<size_t>(
+            std::bit_width(std::max(detail::cache_line_size / sizeof(KeyT),
+                                    size_t{1})) -
+            1);
+
+        constexpr index() noexcept = default;
+
+        constexpr explicit index(
+            const std::array<KeyT, Size> &sorted) noexcept {
+            /* In-order walk of the implicit tree assigns the sorted keys */
+            auto next = size_t{0};
+            auto fill = [&](auto &self, size_t node) -> void {
+                if (node >= node_count) {
+                    return;
+                }
+                for (size_t i = 0; i <= node_keys; ++i) {
+                    self(self, child(node, i));
+                    if (i == node_keys) {
+                        break;
+                    }
+                    auto slot = node * node_keys + i;
+                    keys[slot] = sorted[std::min(next, Size - 1)];
+                    ranks[slot] = static_cast<RankT>(std::min(next, Size));
+                    ++next;
+                }
+            };
+            fill(fill, 0);
+        }
+
+        template <typename Compare>
+        constexpr size_t find(const std::array<KeyT, Size> &,
+                              const KeyT &key,
+                              const Compare &compare) const noexcept {
+            /* Last (so smallest) key >= key seen on the way down */
+            auto candidate = slot_count;
+            auto node = size_t{0};
+            while (node < node_count) {
+                auto rank = node_rank(node, key, compare);
+                candidate =
+                    rank < node_keys ? node * node_keys + rank : candidate;
+                node = child(node, rank);
+            }
+            if (candidate != slot_count && keys[candidate] == key) {
+                return ranks[candidate];
+            }
+            return Size;
+        }
+
+      private:
+        static constexpr size_t child(size_t node, size_t i) noexcept {
+            return node * (node_keys + 1) + i + 1;
+        }
+
+        template <typename Compare>
+        constexpr size_t node_rank(size_t node, const KeyT &key,
+                                   const Compare &compare) const noexcept {
+            const auto *first = keys.data() + node * node_keys;
+            if constexpr (detail::simd_rank_usable_v<KeyUnderlyingT> &&
+                          detail::is_plain_less_v<KeyT, Compare> &&
+                          node_keys * sizeof(KeyT) == node_bytes) {
+                if (!std::is_constant_evaluated()) {
+                    return detail::simd_node_rank<KeyUnderlyingT, node_bytes>(
+                        reinterpret_cast<const KeyUnderlyingT *>(first),
+                        static_cast<KeyUnderlyingT>(key));
+                }
+            }
+            auto rank = size_t{0};
+            for (size_t i = 0; i < node_keys; ++i) {
+                rank += static_cast<size_t>(compare(first[i], key));
+            }
+            return rank;
+        }
+    };
+};
+/// Piecewise linear model of key -> sorted index, fit at compile time over
+/// Segments runs of (about) equally many keys. Each segment interpolates
+/// between its first & last key & records its maximum prediction error, so
+/// a lookup is a prediction followed by a branchless lower bound over the
+/// error window only. For (close to) uniformly distributed integral keys the
+/// window is a handful of keys, i.e. one or two cache lines. Needs keys with
+/// integral underlying type & std::less, other comparisons fall back to a
+/// binary search over the sorted keys
+template <size_t Segments = 1> struct learned_search {
+    static_assert(Segments > 0, "Need at least one segment");
+
+    template <typename KeyT, size_t Size> struct index {
+        static constexpr bool searches_sorted_keys = false;
+
+        using KeyUnderlyingT = detail::underlying_type<KeyT>;
+        static_assert(std::is_integral_v<KeyUnderlyingT>,
+                      "learned_search requires integral (or enum) keys");
+        using KeyUnsignedT = std::make_unsigned_t<KeyUnderlyingT>;
+
+        static constexpr size_t segment_count = std::min(Segments, Size);
+
+        struct segment {
+            double slope{};
+            size_t begin{};
+            size_t end{};
+            size_t error{};
+        };
+
+        /* Kept apart from the models, searched to pick the segment */
+        std::array<KeyUnderlyingT, segment_count> first_keys{};
+        std::array<segment, segment_count> segments{};
+
+        constexpr index() noexcept = default;
+
+        constexpr explicit index(
+            const std::array<KeyT, Size> &sorted) noexcept {
+            /* Only sorted ascending (std::less) keys are modelled, find
+             * doesn't use the model for anything else */
+            for (size_t i = 1; i < Size; ++i) {
+                if (raw(sorted[i]) < raw(sorted[i - 1])) {
+                    return;
+                }
+            }
+            for (size_t s = 0; s < segment_count; ++s) {
+                auto &seg = segments[s];
+                seg.begin = s * Size / segment_count;
+                seg.end = (s + 1) * Size / segment_count;
+                first_keys[s] = raw(sorted[seg.begin]);
+                auto key_span =
+                    distance(first_keys[s], raw(sorted[seg.end - 1]));
+                seg.slope = key_span == 0
+                                ? 0.0
+                                : static_cast<double>(seg.end - seg.begin - 1) /
+                                      static_cast<double>(key_span);
+                for (size_t i = seg.begin; i < seg.end; ++i) {
+                    auto predicted = predict(s, raw(sorted[i]));
+                    auto error = predicted > i ? predicted - i : i - predicted;
+                    seg.error = std::max(seg.error, error);
+                }
+                /* Slack for the runtime prediction rounding differently (e.g.
+                 * fused multiply-add) than the constant evaluated one */
+                seg.error += 1;
+            }
+        }
+
+        template <typename Compare>
+        constexpr size_t find(const std::array<KeyT, Size> &keys,
+                              const KeyT &key,
+                              const Compare &compare) const noexcept {
+            if constexpr (!detail::is_plain_less_v<KeyT, Compare> ||
+                          Size == 0) {
+                return detail::ordered_find_impl_cast(keys.data(), Size, key,
+                                                      compare);
+            } else {
+                auto raw_key = raw(key);
+                auto s = size_t{0};
+                if constexpr (segment_count > 1) {
+                    /* Last segment starting at or before key */
+                    auto it = detail::branchless_upper_bound(
+                        first_keys.begin(), first_keys.end(), raw_key,
+                        std::less<>{});
+                    s = std::max<size_t>(it - first_keys.begin(), 1) - 1;
+                }
+                const auto &seg = segments[s];
+                auto predicted = predict(s, raw_key);
+                auto first = std::max(predicted, seg.begin + seg.error) -
+                             seg.error;
+                auto last = std::min(predicted + seg.error + 1, seg.end);
+                auto idx = detail::ordered_find_impl_cast(
+                    keys.data() + first, last - first, key, compare);
+                return idx == last - first ? Size : first + idx;
+            }
+        }
+
+      private:
+        static constexpr KeyUnderlyingT raw(const KeyT &key) noexcept {
+            return static_cast<KeyUnderlyingT>(key);
+        }
+
+        /* Wraps around (to a huge distance) for keys below first */
+        static constexpr KeyUnsignedT distance(KeyUnderlyingT first,
+                                               KeyUnderlyingT key) noexcept {
+            return static_cast<KeyUnsignedT>(static_cast<KeyUnsignedT>(key) -
+                                             static_cast<KeyUnsignedT>(first));
+        }
+
+        /* Predicted sorted index of key, clamped to segment s */
+        constexpr size_t predict(size_t s, KeyUnderlyingT key) const noexcept {
+            const auto &seg = segments[s];
+            auto offset =
+                static_cast<double>(distance(first_keys[s], key)) * seg.slope;
+            offset = std::min(offset,
+                              static_cast<double>(seg.end - seg.begin - 1));
+            return seg.begin + static_cast<size_t>(offset);
+        }
+    };
+};
+
+/// Single straight line over all keys
+using interpolation_search = learned_search<1>;
+/// Frame of reference: the keys stored as key - smallest key in PackedT (see
+/// make_packed_ordered_keyset, which picks the narrowest one). Queries are
+/// rebased & range checked, then searched over the packed keys, so the search
+/// touches 2-8x fewer cache lines than over full width keys. Under std::less
+/// the packed keys replace the keyset's own, iteration rebuilding each key
+/// (see packed_key_iterator). Needs integral (or enum) keys, other
+/// comparisons keep & search the sorted keys
+template <typename PackedT> struct frame_of_reference_search {
+    static_assert(std::is_unsigned_v<PackedT>, "Packed type must be unsigned");
+
+    template <typename KeyT, size_t Size> struct index {
+        static constexpr bool searches_sorted_keys = false;
+        template <typename Compare>
+        static constexpr bool stores_keys =
+            detail::is_plain_less_v<KeyT, Compare>;
+
+        using KeyUnderlyingT = detail::underlying_type<KeyT>;
+        static_assert(std::is_integral_v<KeyUnderlyingT>,
+                      "frame_of_reference_search requires integral keys");
+        using KeyUnsignedT = std::make_unsigned_t<KeyUnderlyingT>;
+        using const_iterator = detail::packed_key_iterator<KeyT, PackedT>;
+
+        KeyUnderlyingT reference{};
+        std::array<PackedT, Size> keys{};
+
+        constexpr index() noexcept = default;
+
+        constexpr explicit index(
+            const std::array<KeyT, Size> &sorted) noexcept {
+            if constexpr (Size != 0) {
+                /* Only sorted ascending (std::less) keys are packed, find
+                 * doesn't use them for anything else */
+                for (size_t i = 1; i < Size; ++i) {
+                    if (raw(sorted[i]) < raw(sorted[i - 1])) {
+                        return;
+                    }
+                }
+                reference = raw(sorted[0]);
+                constexpr_assert(
+                    rebase(raw(sorted[Size - 1])) <=
+                        std::numeric_limits<PackedT>::max(),
+                    "Key range doesn't fit into the packed type");
+                for (size_t i = 0; i < Size; ++i) {
+                    keys[i] = static_cast<PackedT>(rebase(raw(sorted[i])));
+                }
+            }
+        }
+
+        template <typename Compare>
+        constexpr size_t find(const std::array<KeyT, Size> &sorted,
+                              const KeyT &key,
+                              const Compare &compare) const noexcept {
+            if constexpr (!detail::is_plain_less_v<KeyT, Compare>) {
+                return detail::ordered_find_impl_cast(sorted.data(), Size, key,
+                                                      compare);
+            } else {
+                return find(key);
+            }
+        }
+
+        constexpr size_t find(const KeyT &key) const noexcept {
+            /* Keys below the reference wrap around, so are out of range as
+             * well */
+            auto offset = rebase(raw(key));
+            if (offset > std::numeric_limits<PackedT>::max()) {
+                return Size;
+            }
+            return detail::ordered_find_impl(keys.data(), Size,
+                                             static_cast<PackedT>(offset),
+                                             std::less<PackedT>{});
+        }
+
+        constexpr const_iterator begin() const noexcept {
+            return const_iterator{keys.data(), reference};
+        }
+
+        constexpr const_iterator end() const noexcept {
+            return const_iterator{keys.data() + Size, reference};
+        }
+
+      private:
+        static constexpr KeyUnderlyingT raw(const KeyT &key) noexcept {
+            return static_cast<KeyUnderlyingT>(key);
+        }
+
+        constexpr KeyUnsignedT rebase(KeyUnderlyingT key) const noexcept {
+            return static_cast<KeyUnsignedT>(static_cast<KeyUnsignedT>(key) -
+                                             static_cast<KeyUnsignedT>(
+                                                 reference));
+        }
+    };
+};
+
+/// Vectorized equality scan over the sorted keys, for tiny keysets (see
+/// auto_search) where a single pass over a few vectors beats the dependent
+/// steps of a binary search. The last load is clamped to the end of the keys
+/// (as simd_probe does), so nothing is stored besides them. Needs integral
+/// (or enum) keys filling at least one vector, otherwise falls back to
+/// sorted_search
+struct linear_scan_search {
+    /// Widest vector (in bytes) not wider than Size keys, 0 if none
+    template <typename KeyT, size_t Size>
+    static constexpr size_t width = []() {
+        constexpr auto bytes = Size * sizeof(KeyT);
+        constexpr auto max_width = lookup::detail::simd_probe_max_width;
+        return bytes >= 32 && max_width >= 32   ? size_t{32}
+               : bytes >= 16 && max_width >= 16 ? size_t{16}
+                                                : size_t{0};
+    }();
+
+    /// Whether the scan is usable (& worth it) for the given keys
+    template <typename KeyT, size_t Size>
+    static constexpr bool preferred =
+        width<KeyT, Size> != 0 &&
+        std::is_integral_v<detail::underlying_type<KeyT>> && Size <= 32 &&
+        Size * sizeof(KeyT) <= 128;
+
+    template <typename KeyT, size_t Size> struct index {
+        static constexpr bool searches_sorted_keys = false;
+
+        using KeyUnderlyingT = detail::underlying_type<KeyT>;
+
+        static constexpr bool usable = preferred<KeyT, Size>;
+        static constexpr size_t lanes =
+            usable ? width<KeyT, Size> / sizeof(KeyUnderlyingT) : 1;
+        static constexpr size_t bits_per_lane =
+            sizeof(KeyUnderlyingT) * lookup::detail::simd_probe_bits_per_byte;
+
+        constexpr index() noexcept = default;
+        constexpr explicit index(const std::array<KeyT, Size> &) noexcept {}
+
+        template <typename Compare>
+        constexpr size_t find(const std::array<KeyT, Size> &sorted,
+                              const KeyT &key,
+                              const Compare &compare) const noexcept {
+            if constexpr (usable) {
+                if (!std::is_constant_evaluated()) {
+                    auto raw_key = static_cast<KeyUnderlyingT>(key);
+                    const auto *base =
+                        reinterpret_cast<const std::byte *>(sorted.data());
+                    /* Lanes overlapping the previous load were already
+                     * compared (without a match) */
+                    for (size_t i = 0; i < Size; i += lanes) {
+                        auto load = std::min(i, Size - lanes);
+                        auto match = lookup::detail::simd_probe_match<
+                            KeyUnderlyingT, width<KeyT, Size>>(
+                            base + load * sizeof(KeyT), raw_key);
+                        if (match != 0) {
+                            return load + static_cast<size_t>(
+                                              std::countr_zero(match)) /
+                                              bits_per_lane;
+                        }
+                    }
+                    return Size;
+                }
+            }
+            return detail::ordered_find_impl_cast(sorted.data(), Size, key,
+                                                  compare);
+        }
+    };
+};
+
+/// Picks linear_scan_search for tiny integral keysets, sorted_search
+/// otherwise. The default for the ordered maps
+struct auto_search {
+    template <typename KeyT, size_t Size>
+    using index = typename std::conditional_t<
+        linear_scan_search::preferred<KeyT, Size>, linear_scan_search,
+        sorted_search>::template index<KeyT, Size>;
+};
+/// Checks HotKeys (a std::array of the most accessed keys, hottest first, see
+/// make_weighted_ordered_keyset) one by one before falling back to Search, so
+/// the common lookups cost a compare or two
+template <auto HotKeys, typename Search = auto_search> struct hot_key_search {
+    template <typename KeyT, size_t Size> struct index {
+        static constexpr bool searches_sorted_keys = false;
+
+        using RankT = detail::ordered_index_t<Size>;
+        using InnerT = typename Search::template index<KeyT, Size>;
+
+        /* Sorted index of every hot key */
+        std::array<RankT, HotKeys.size()> ranks{};
+        [[no_unique_address]] InnerT inner{};
+
+        constexpr index() noexcept = default;
+
+        constexpr explicit index(const std::array<KeyT, Size> &sorted) noexcept
+            : inner(sorted) {
+            for (size_t h = 0; h < HotKeys.size(); ++h) {
+                auto it = std::find(sorted.begin(), sorted.end(),
+                                    static_cast<KeyT>(HotKeys[h]));
+                constexpr_assert(it != sorted.end(),
+                                 "Hot key not in the keyset");
+                ranks[h] = static_cast<RankT>(it - sorted.begin());
+            }
+        }
+
+        template <typename Compare>
+        constexpr size_t find(const std::array<KeyT, Size> &sorted,
+                              const KeyT &key,
+                              const Compare &compare) const noexcept {
+            for (size_t h = 0; h < HotKeys.size(); ++h) {
+                if (static_cast<KeyT>(HotKeys[h]) == key) {
+                    return ranks[h];
+                }
+            }
+            return inner.find(sorted, key, compare);
+        }
+    };
+};
+}; // namespace heurohash
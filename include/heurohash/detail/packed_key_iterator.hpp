@@ -0,0 +1,102 @@
+#pragma once
+
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+#include "traits.hpp"
+
+namespace heurohash::detail {
+/// Iterator over keys stored as offsets from the smallest key (see
+/// frame_of_reference_search), key i being first + packed[i]. Dereferences to
+/// KeyT (by value), so it stands in for the key pointers of other keysets
+template <typename KeyT, typename PackedT> class packed_key_iterator {
+    using KeyUnderlyingT = detail::underlying_type<KeyT>;
+    using KeyUnsignedT = std::make_unsigned_t<KeyUnderlyingT>;
+
+    const PackedT *packed = nullptr;
+    KeyUnderlyingT first{};
+
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = KeyT;
+    using reference = KeyT;
+    using pointer = void;
+
+    constexpr packed_key_iterator() noexcept = default;
+
+    constexpr packed_key_iterator(const PackedT *packed,
+                                  KeyUnderlyingT first) noexcept
+        : packed(packed), first(first) {}
+
+    /* Unsigned arithmetic, so keys below 0 wrap back into place */
+    constexpr reference operator*() const noexcept {
+        return static_cast<KeyT>(static_cast<KeyUnderlyingT>(
+            static_cast<KeyUnsignedT>(static_cast<KeyUnsignedT>(first) +
+                                      *packed)));
+    }
+
+    constexpr reference operator[](difference_type n) const noexcept {
+        return *(*this + n);
+    }
+
+    /* The packed key, for prefetching */
+    constexpr const PackedT *base() const noexcept { return packed; }
+
+    constexpr packed_key_iterator &operator++() noexcept { return *this += 1; }
+
+    constexpr packed_key_iterator operator++(int) noexcept {
+        auto tmp = *this;
+        ++(*this);
+        return tmp;
+    }
+
+    constexpr packed_key_iterator &operator--() noexcept { return *this -= 1; }
+
+    constexpr packed_key_iterator operator--(int) noexcept {
+        auto tmp = *this;
+        --(*this);
+        return tmp;
+    }
+
+    constexpr packed_key_iterator &operator+=(difference_type n) noexcept {
+        packed += n;
+        return *this;
+    }
+
+    constexpr packed_key_iterator &operator-=(difference_type n) noexcept {
+        packed -= n;
+        return *this;
+    }
+
+    constexpr packed_key_iterator operator+(difference_type n) const noexcept {
+        return packed_key_iterator{packed + n, first};
+    }
+
+    friend constexpr packed_key_iterator
+    operator+(difference_type n, const packed_key_iterator &it) noexcept {
+        return it + n;
+    }
+
+    constexpr packed_key_iterator operator-(difference_type n) const noexcept {
+        return packed_key_iterator{packed - n, first};
+    }
+
+    constexpr difference_type
+    operator-(const packed_key_iterator &other) const noexcept {
+        return packed - other.packed;
+    }
+
+    constexpr auto
+    operator<=>(const packed_key_iterator &other) const noexcept {
+        return packed <=> other.packed;
+    }
+
+    constexpr bool
+    operator==(const packed_key_iterator &other) const noexcept {
+        return packed == other.packed;
+    }
+};
+} // namespace heurohash::detail
@@ -0,0 +1,380 @@
+#pragma once
+
+/*
+ * Minimal perfect hash in the spirit of PTHash:
+ *      Pibiri & Trani, "PTHash: Revisiting FCH Minimal Perfect Hashing"
+ *
+ * Keys are first hashed into small buckets (~3 keys each). Then, starting
+ * with the largest bucket, a "pilot" is searched for every bucket which places
+ * all of its keys into still free slots of a table slightly larger than the
+ * key count. Slots past the key count are remapped into the holes left below
+ * it (spill table), so the final positions are exactly 0..n-1.
+ *
+ * Pilots are stored as a single byte per bucket, the few (<1%) that don't fit
+ * are escaped into a small sorted overflow table.
+ *
+ * Lookup is a hash, a pilot load, a key compare (+ a rare spill/overflow load)
+ * & the auxiliary data is ~3 bits per key (a pilot byte per ~3 keys, plus the
+ * spill table's ~1/32 entry per key). As opposed to the pseudo-pext LUT,
+ * this doesn't depend on how the key bits are distributed, so it's the better
+ * fit for large or adversarial key sets.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "comp_time_arg.hpp"
+#include "pseudo_pext_lookup.hpp"
+
+namespace lookup {
+
+namespace detail {
+/// Average number of keys per bucket
+inline constexpr std::size_t pilot_bucket_load = 3;
+/// Pilots >= this are looked up in the overflow table
+inline constexpr std::uint64_t pilot_escape = 0xff;
+/// Give up on a seed if a bucket can't be placed with this many pilots
+inline constexpr std::uint64_t pilot_search_limit = 1U << 16U;
+inline constexpr std::uint64_t pilot_max_seeds = 16;
+
+__extension__ using pilot_uint128_t = unsigned __int128;
+
+/// murmur3 finalizer (a bijection, so distinct keys keep distinct hashes)
+[[nodiscard]] constexpr auto fmix64(std::uint64_t x) noexcept
+    -> std::uint64_t {
+    x ^= x >> 33U;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33U;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33U;
+    return x;
+}
+
+/// Maps x onto [0, range) using the high bits (no division)
+[[nodiscard]] constexpr auto fastrange(std::uint64_t x,
+                                       std::size_t range) noexcept
+    -> std::size_t {
+    return static_cast<std::size_t>(
+        (static_cast<pilot_uint128_t>(x) * range) >> 64U);
+}
+
+template <typename Raw>
+[[nodiscard]] constexpr auto pilot_key_hash(Raw const &raw,
+                                            std::uint64_t seed) noexcept
+    -> std::uint64_t {
+    if constexpr (is_raw_words<Raw>::value) {
+        auto hash = seed;
+        for (auto word : raw) {
+            hash = fmix64(hash ^ word);
+        }
+        return hash;
+    } else {
+        return fmix64(static_cast<std::uint64_t>(raw) ^ seed);
+    }
+}
+
+[[nodiscard]] constexpr auto pilot_position(std::uint64_t hash,
+                                            std::uint64_t pilot,
+                                            std::size_t table_size) noexcept
+    -> std::size_t {
+    return fastrange(fmix64(hash ^ (pilot * 0x9e3779b97f4a7c15ULL)),
+                     table_size);
+}
+
+constexpr auto pilot_bucket_count(std::size_t size) -> std::size_t {
+    return std::max<std::size_t>(1, (size + pilot_bucket_load - 1) /
+                                        pilot_bucket_load);
+}
+
+/// ~3% slack, makes placing the last buckets cheap
+constexpr auto pilot_spill_size(std::size_t size) -> std::size_t {
+    return size / 32 + 1;
+}
+
+template <std::size_t Size, std::size_t Buckets, std::size_t Spill>
+struct pilot_search_result {
+    bool found{};
+    std::uint64_t seed{};
+    std::uint64_t max_pilot{};
+    std::size_t overflow_count{};
+    std::array<std::uint64_t, Buckets> pilots{};
+    std::array<std::size_t, Spill> spill{};
+    /* Final index of every input key */
+    std::array<std::size_t, Size> positions{};
+};
+
+template <std::size_t Buckets, std::size_t Spill, typename T, std::size_t S>
+constexpr auto search_pilots(std::array<T, S> const &keys,
+                             std::uint64_t seed) {
+    constexpr auto table_size = S + Spill;
+    auto result = pilot_search_result<S, Buckets, Spill>{};
+    result.seed = seed;
+
+    std::vector<std::uint64_t> hashes(S);
+    std::vector<std::size_t> bucket_start(Buckets + 1);
+    for (auto i = std::size_t{}; i < S; ++i) {
+        hashes[i] = pilot_key_hash(keys[i], seed);
+        ++bucket_start[fastrange(hashes[i], Buckets) + 1];
+    }
+    std::partial_sum(bucket_start.begin(), bucket_start.end(),
+                     bucket_start.begin());
+
+    // keys grouped by bucket (counting sort)
+    std::vector<std::size_t> members(S);
+    auto bucket_fill = bucket_start;
+    for (auto i = std::size_t{}; i < S; ++i) {
+        members[bucket_fill[fastrange(hashes[i], Buckets)]++] = i;
+    }
+
+    // buckets ordered by size, largest first (counting sort again)
+    std::vector<std::size_t> size_start(S + 2);
+    for (auto b = std::size_t{}; b < Buckets; ++b) {
+        ++size_start[S - (bucket_start[b + 1] - bucket_start[b]) + 1];
+    }
+    std::partial_sum(size_start.begin(), size_start.end(), size_start.begin());
+    std::vector<std::size_t> order(Buckets);
+    for (auto b = std::size_t{}; b < Buckets; ++b) {
+        order[size_start[S - (bucket_start[b + 1] - bucket_start[b])]++] = b;
+    }
+
+    std::vector<std::uint8_t> taken(table_size);
+    std::vector<std::size_t> slots(S);
+    for (auto b : order) {
+        auto const first = bucket_start[b];
+        auto const last = bucket_start[b + 1];
+        if (first == last) {
+            break; // only empty ones left
+        }
+
+        auto pilot = std::uint64_t{};
+        for (;; ++pilot) {
+            if (pilot == pilot_search_limit) {
+                return result;
+            }
+
+            auto placed = first;
+            for (; placed < last; ++placed) {
+                auto const pos =
+                    pilot_position(hashes[members[placed]], pilot, table_size);
+                if (taken[pos] != 0) {
+                    break;
+                }
+                taken[pos] = 1;
+                slots[members[placed]] = pos;
+            }
+            if (placed == last) {
+                break;
+            }
+            // undo the partial placement
+            for (auto i = first; i < placed; ++i) {
+                taken[slots[members[i]]] = 0;
+            }
+        }
+        result.pilots[b] = pilot;
+        result.max_pilot = std::max(result.max_pilot, pilot);
+        if (pilot >= pilot_escape) {
+            ++result.overflow_count;
+        }
+    }
+
+    // slots past the key count are moved into the holes below it
+    auto hole = std::size_t{};
+    for (auto pos = S; pos < table_size; ++pos) {
+        if (taken[pos] != 0) {
+            while (taken[hole] != 0) {
+                ++hole;
+            }
+            result.spill[pos - S] = hole++;
+        }
+    }
+    for (auto i = std::size_t{}; i < S; ++i) {
+        result.positions[i] =
+            slots[i] < S ? slots[i] : result.spill[slots[i] - S];
+    }
+
+    result.found = true;
+    return result;
+}
+
+/// Tries seeds until every bucket could be placed (almost always the first)
+template <std::size_t Buckets, std::size_t Spill, typename T, std::size_t S>
+constexpr auto find_pilots(std::array<T, S> const &keys) {
+    auto result = search_pilots<Buckets, Spill>(keys, 0);
+    for (auto seed = std::uint64_t{1}; !result.found && seed < pilot_max_seeds;
+         ++seed) {
+        result = search_pilots<Buckets, Spill>(keys, seed);
+    }
+    return result;
+}
+} // namespace detail
+
+template <typename StorageT, std::size_t Buckets, std::size_t Spill,
+          std::size_t Overflow, typename OverflowPilotT>
+struct pilot_mph {
+    using key_type = StorageT::value_type;
+    using storage_t = std::remove_cv_t<StorageT>;
+    using raw_key_type = detail::raw_integral_t<key_type>;
+    using overflow_pilot_type = OverflowPilotT;
+
+    static constexpr size_t keys_size_v = std::tuple_size_v<storage_t>;
+    static constexpr size_t table_size_v = keys_size_v + Spill;
+
+    storage_t key_storage;
+    std::array<std::uint8_t, Buckets> pilots;
+    /* Escaped pilots, sorted by bucket */
+    std::array<detail::uint_for_<Buckets>, Overflow> overflow_buckets;
+    std::array<OverflowPilotT, Overflow> overflow_pilots;
+    std::array<detail::uint_for_<keys_size_v>, Spill> spill;
+    std::uint64_t seed;
+
+    [[nodiscard]] constexpr __attribute__((always_inline)) std::uint64_t
+    pilot(size_t bucket) const noexcept {
+        auto const p = pilots[bucket];
+        if (p < detail::pilot_escape) [[likely]] {
+            return p;
+        }
+        auto const it = std::lower_bound(overflow_buckets.begin(),
+                                         overflow_buckets.end(), bucket);
+        return overflow_pilots[static_cast<size_t>(
+            std::distance(overflow_buckets.begin(), it))];
+    }
+
+    /* Index of the only slot key can be in */
+    [[nodiscard]] constexpr __attribute__((always_inline)) size_t
+    slot(std::uint64_t hash) const noexcept {
+        auto const pos = detail::pilot_position(
+            hash, pilot(detail::fastrange(hash, Buckets)), table_size_v);
+        return pos < keys_size_v ? pos : spill[pos - keys_size_v];
+    }
+
+    [[nodiscard]] constexpr __attribute__((always_inline)) size_t
+    probe(raw_key_type raw_key, size_t i) const noexcept {
+        return raw_key == detail::as_raw_integral(key_storage[i])
+                   ? i
+                   : key_storage.size();
+    }
+
+    [[nodiscard]] constexpr __attribute__((always_inline)) size_t
+    lookup(key_type key) const noexcept {
+        auto const raw_key = detail::as_raw_integral(key);
+        return probe(raw_key, slot(detail::pilot_key_hash(raw_key, seed)));
+    }
+
+    /* Same blocking scheme as pseudo_next_indirect: hash the whole block &
+     * load the pilots, then resolve the slots & only then verify the keys */
+    static constexpr size_t lookup_block_size = 16;
+
+    /* Calls emit(input_idx, found_idx) for every key */
+    template <typename Func>
+    constexpr void lookup_many(const key_type *keys, size_t count,
+                               Func &&emit) const noexcept {
+        std::array<raw_key_type, lookup_block_size> raw_keys{};
+        std::array<std::uint64_t, lookup_block_size> hashes{};
+        std::array<size_t, lookup_block_size> slots{};
+
+        for (auto base = std::size_t{0}; base < count;
+             base += lookup_block_size) {
+            auto const block = std::min(lookup_block_size, count - base);
+
+            for (auto i = std::size_t{0}; i < block; ++i) {
+                raw_keys[i] = detail::as_raw_integral(keys[base + i]);
+                hashes[i] = detail::pilot_key_hash(raw_keys[i], seed);
+                if (!std::is_constant_evaluated()) {
+                    __builtin_prefetch(
+                        pilots.data() +
+                        detail::fastrange(hashes[i], Buckets));
+                }
+            }
+
+            for (auto i = std::size_t{0}; i < block; ++i) {
+                slots[i] = slot(hashes[i]);
+                if (!std::is_constant_evaluated()) {
+                    __builtin_prefetch(key_storage.data() + slots[i]);
+                }
+            }
+
+            for (auto i = std::size_t{0}; i < block; ++i) {
+                emit(base + i, probe(raw_keys[i], slots[i]));
+            }
+        }
+    }
+
+    constexpr size_t find(key_type key) const noexcept { return lookup(key); }
+
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<size_t> out) const noexcept {
+        lookup_many(in.data(), in.size(),
+                    [&](size_t i, size_t idx) { out[i] = idx; });
+    }
+
+    constexpr size_t size() const noexcept { return key_storage.size(); }
+    constexpr size_t bucket_count() const noexcept { return Buckets; }
+    constexpr size_t spill_size() const noexcept { return Spill; }
+    constexpr size_t overflow_size() const noexcept { return Overflow; }
+
+    constexpr const key_type *begin() const noexcept {
+        return key_storage.data();
+    }
+};
+
+struct pilot_mph_lookup {
+    [[nodiscard]] constexpr static auto make(comp_time auto comp_time_builder) {
+        constexpr auto input = comp_time_builder();
+
+        constexpr auto raw_keys = detail::get_raw_keys(input);
+        static_assert(detail::keys_are_unique(raw_keys),
+                      "Lookup keys must be unique.");
+
+        constexpr auto size = raw_keys.size();
+        constexpr auto buckets = detail::pilot_bucket_count(size);
+        constexpr auto spill_size = detail::pilot_spill_size(size);
+        constexpr auto search =
+            detail::find_pilots<buckets, spill_size>(raw_keys);
+        static_assert(search.found, "Could not find pilots for the keys");
+
+        constexpr auto storage = [&]() {
+            auto const orig = detail::get_orig_keys(input);
+            auto s = decltype(orig){};
+            for (auto i = std::size_t{}; i < size; ++i) {
+                s[search.positions[i]] = orig[i];
+            }
+            return s;
+        }();
+
+        constexpr auto overflow = search.overflow_count;
+        using overflow_pilot_t = detail::uint_for_<search.max_pilot>;
+        using lookup_t = pilot_mph<std::remove_cv_t<decltype(storage)>,
+                                   buckets, spill_size, overflow,
+                                   overflow_pilot_t>;
+
+        return [&]() {
+            auto l = lookup_t{storage, {}, {}, {}, {}, search.seed};
+            auto escaped = std::size_t{};
+            for (auto b = std::size_t{}; b < buckets; ++b) {
+                auto const pilot = search.pilots[b];
+                if (pilot < detail::pilot_escape) {
+                    l.pilots[b] = static_cast<std::uint8_t>(pilot);
+                } else {
+                    l.pilots[b] = detail::pilot_escape;
+                    l.overflow_buckets[escaped] =
+                        static_cast<detail::uint_for_<buckets>>(b);
+                    l.overflow_pilots[escaped++] =
+                        static_cast<overflow_pilot_t>(pilot);
+                }
+            }
+            for (auto i = std::size_t{}; i < spill_size; ++i) {
+                l.spill[i] = static_cast<detail::uint_for_<size>>(
+                    search.spill[i]);
+            }
+            return l;
+        }();
+    }
+};
+} // namespace lookup
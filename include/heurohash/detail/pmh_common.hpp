@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "pseudo_pext_lookup.hpp"
+
+namespace heurohash::detail {
+static constexpr inline size_t hash_map_pnext_depth = 2;
+} // namespace heurohash::detail
+
+namespace heurohash {
+/* Lookup engines for the make_hash_* functions */
+/// Pseudo-pext LUT. Smallest for small & "nice" key sets
+/// LutPolicy picks the LUT representation (see detail/compressed_lut.hpp),
+/// SearchPolicy the probe/memory tradeoff (see pseudo_pext_lookup.hpp)
+template <typename LutPolicy = lookup::dense_lut_policy,
+          typename SearchPolicy =
+              lookup::fixed_search_len<detail::hash_map_pnext_depth>>
+struct basic_pext_hash_engine {
+    using lut_policy = LutPolicy;
+    using search_policy = SearchPolicy;
+};
+/// Dense LUT, the default
+using pext_hash_engine = basic_pext_hash_engine<>;
+/// LUT entries packed into exactly bit_width(N - 1) bits
+using packed_pext_hash_engine =
+    basic_pext_hash_engine<lookup::bit_packed_lut_policy>;
+/// Only the used LUT entries, found via occupancy bitmap + rank
+using rank_pext_hash_engine = basic_pext_hash_engine<lookup::rank_lut_policy>;
+/// Dense LUT with the given search length policy, e.g.
+/// tuned_pext_hash_engine<lookup::min_memory<3>>
+template <typename SearchPolicy>
+using tuned_pext_hash_engine =
+    basic_pext_hash_engine<lookup::dense_lut_policy, SearchPolicy>;
+/// PTHash-style minimal perfect hash, ~3 bits per key for any key set
+struct pilot_hash_engine {};
+} // namespace heurohash
+
+namespace heurohash::detail {
+template <typename KeyT, size_t Size, size_t LutSize, size_t Depth,
+          typename LutT = std::array<lookup::lookup_idx_exp_t<Size>, LutSize>>
+using pseudo_next_t =
+    lookup::pseudo_next_indirect<std::array<KeyT, Size>, LutT, Depth>;
+} // namespace heurohash::detail
@@ -17,39 +17,195 @@
 #include <algorithm>
 #include <array>
 #include <bit>
-#include <bitset>
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
 #include <limits>
+#include <numeric>
 #include <span>
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "comp_time_arg.hpp"
+#include "compressed_lut.hpp"
+#include "simd_probe.hpp"
+
+/* Use the hardware bit-extract (BMI2 pext) when the target supports it.
+ * Note that this changes the hash function itself (real pext instead of the
+ * multiply based emulation), so the lookup tables are built accordingly.
+ * All TUs sharing a map must therefore agree on this setting - it can be
+ * forced off by defining HEUROHASH_DISABLE_BMI2_PEXT */
+#if defined(__BMI2__) && !defined(HEUROHASH_DISABLE_BMI2_PEXT)
+#define HEUROHASH_USE_BMI2_PEXT 1
+#include <immintrin.h>
+#else
+#define HEUROHASH_USE_BMI2_PEXT 0
+#endif
 
 namespace lookup {
 
 namespace detail {
+/// Multi-word raw representation, used for keys wider than 64 bits
+template <std::size_t Words>
+using raw_words_t = std::array<std::uint64_t, Words>;
+
+template <typename T> struct is_raw_words : std::false_type {};
+template <std::size_t Words>
+struct is_raw_words<raw_words_t<Words>> : std::true_type {};
+
+template <typename T>
+concept tuple_like_key = requires { std::tuple_size<T>::value; };
+
+template <std::size_t Bits> constexpr auto raw_uint_for_bits() {
+    if constexpr (Bits <= 8) {
+        return std::uint8_t{};
+    } else if constexpr (Bits <= 16) {
+        return std::uint16_t{};
+    } else if constexpr (Bits <= 32) {
+        return std::uint32_t{};
+    } else {
+        return std::uint64_t{};
+    }
+}
+
+/// Raw word(s) holding Bits bits: single integral if it fits, else array
+template <std::size_t Bits>
+using raw_for_bits_t =
+    std::conditional_t<(Bits <= 64), decltype(raw_uint_for_bits<Bits>()),
+                       raw_words_t<(Bits + 63) / 64>>;
+
+template <typename Raw>
+constexpr void raw_set_bits(Raw &raw, std::size_t pos, std::uint64_t value) {
+    if constexpr (is_raw_words<Raw>::value) {
+        raw[pos / 64] |= value << (pos % 64);
+    } else {
+        raw = static_cast<Raw>(raw | (value << pos));
+    }
+}
+
+/// Objects of any size (no padding bits!) - little endian byte packing
+template <typename V> constexpr auto raw_from_bytes(const V &v) {
+    using raw_t = raw_for_bits_t<sizeof(V) * 8>;
+    auto const bytes = std::bit_cast<std::array<std::uint8_t, sizeof(V)>>(v);
+    auto raw = raw_t{};
+    for (auto i = std::size_t{}; i < sizeof(V); ++i) {
+        raw_set_bits(raw, i * 8, bytes[i]);
+    }
+    return raw;
+}
+
+constexpr auto as_raw_integral(auto v);
+
+/// Bit layout of packed tuple-like keys. Members don't straddle 64-bit words,
+/// so that every member can be written with a single shift
+template <typename V, std::size_t... Is>
+constexpr auto tuple_key_layout(std::index_sequence<Is...>) {
+    std::array<std::size_t, sizeof...(Is) + 1> offsets{};
+    constexpr std::array<std::size_t, sizeof...(Is)> widths{
+        (sizeof(decltype(as_raw_integral(
+             std::declval<std::tuple_element_t<Is, V>>()))) *
+         8)...};
+    auto pos = std::size_t{};
+    for (auto i = std::size_t{}; i < widths.size(); ++i) {
+        if ((pos % 64) + widths[i] > 64) {
+            pos += 64 - (pos % 64);
+        }
+        offsets[i] = pos;
+        pos += widths[i];
+    }
+    offsets.back() = pos;
+    return offsets;
+}
+
+/// Tuple-like keys (pair, tuple, array) are packed member-wise
+template <typename V> constexpr auto raw_from_tuple(const V &v) {
+    constexpr auto seq = std::make_index_sequence<std::tuple_size_v<V>>{};
+    constexpr auto layout = tuple_key_layout<V>(seq);
+    using raw_t = raw_for_bits_t<layout.back()>;
+    auto raw = raw_t{};
+    [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+        (raw_set_bits(raw, layout[Is],
+                      static_cast<std::uint64_t>(
+                          as_raw_integral(std::get<Is>(v)))),
+         ...);
+    }(seq);
+    return raw;
+}
+
 constexpr auto as_raw_integral(auto v) {
-    static_assert(sizeof(v) <= 8);
     static_assert(!std::is_pointer_v<decltype(v)>);
 
-    if constexpr (sizeof(v) == 1) {
+    if constexpr (tuple_like_key<decltype(v)>) {
+        return raw_from_tuple(v);
+    } else if constexpr (sizeof(v) == 1) {
         return std::bit_cast<std::uint8_t>(v);
     } else if constexpr (sizeof(v) == 2) {
         return std::bit_cast<std::uint16_t>(v);
-    } else if constexpr (sizeof(v) <= 4) {
+    } else if constexpr (sizeof(v) == 4) {
         return std::bit_cast<std::uint32_t>(v);
-    } else if constexpr (sizeof(v) <= 8) {
+    } else if constexpr (sizeof(v) == 8) {
         return std::bit_cast<std::uint64_t>(v);
+    } else {
+        static_assert(std::has_unique_object_representations_v<decltype(v)>,
+                      "Wide keys must not contain padding");
+        return raw_from_bytes(v);
     }
 }
 
 template <typename T>
 using raw_integral_t = decltype(as_raw_integral(std::declval<T>()));
 
+/// Whether a key's object representation is its raw value, so that raw keys
+/// can be compared straight from the key storage (vector probes). Not so for
+/// tuple-like keys, which are packed member-wise (member order & padding in
+/// memory differ), nor for keys zero extended to a wider raw integral
+template <typename KeyT>
+inline constexpr bool raw_is_object_bytes_v =
+    !tuple_like_key<KeyT> && std::is_integral_v<raw_integral_t<KeyT>> &&
+    sizeof(KeyT) == sizeof(raw_integral_t<KeyT>);
+
+template <typename KeyT, typename ValueT> struct kv_entry_layout {
+    KeyT key;
+    ValueT value;
+};
+
+/// Key & value stored together (AoS storage). Padded to a power of two (up
+/// to a cache line), so that an entry never straddles two lines
+template <typename KeyT, typename ValueT>
+struct alignas(sizeof(kv_entry_layout<KeyT, ValueT>) <= 64
+                   ? std::bit_ceil(sizeof(kv_entry_layout<KeyT, ValueT>))
+                   : alignof(kv_entry_layout<KeyT, ValueT>)) kv_entry {
+    KeyT key;
+    ValueT value;
+};
+
+template <typename T> struct is_kv_entry : std::false_type {};
+template <typename KeyT, typename ValueT>
+struct is_kv_entry<kv_entry<KeyT, ValueT>> : std::true_type {};
+template <typename T>
+inline constexpr bool is_kv_entry_v = is_kv_entry<std::remove_cv_t<T>>::value;
+
+/// Plain array of bucket start indices (dense_lut_policy)
+template <typename T> struct is_dense_lut : std::false_type {};
+template <typename T, std::size_t S>
+struct is_dense_lut<std::array<T, S>> : std::is_unsigned<T> {};
+template <typename T>
+inline constexpr bool is_dense_lut_v = is_dense_lut<std::remove_cv_t<T>>::value;
+
+/// Key of a storage entry (the entry itself, unless it is a kv_entry)
+template <typename T> constexpr auto const &entry_key(T const &e) noexcept {
+    if constexpr (is_kv_entry_v<T>) {
+        return e.key;
+    } else {
+        return e;
+    }
+}
+
+template <typename T>
+using entry_key_t = std::remove_cvref_t<decltype(entry_key(std::declval<T>()))>;
+
 template <uint64_t BiggestValue> auto uint_for_f() {
     if constexpr (BiggestValue <= std::numeric_limits<uint8_t>::max()) {
         return uint8_t{};
@@ -68,27 +224,20 @@ template <uint64_t BiggestValue> auto uint_for_f() {
 template <uint64_t BiggestValue>
 using uint_for_ = decltype(uint_for_f<BiggestValue>());
 
-/* FIXME: All this bitset stuff is constexpr only from C++23 */
-/* Ideally we would have C++20 support by replicating manually */
-template <typename T> constexpr auto bitset_to_type(const auto &bitset) {
-    return static_cast<T>(bitset.to_ullong());
-}
-
 /// log n
 template <typename T>
 constexpr auto compute_pack_coefficient(std::size_t dst, T const mask) -> T {
     constexpr auto t_digits = std::numeric_limits<T>::digits;
 
-    auto pack_coefficient = std::bitset<t_digits>{};
-    auto const mask_bits = std::bitset<t_digits>{mask};
+    auto pack_coefficient = T{};
 
     bool prev_src_bit_set = false;
     for (auto src = std::size_t{}; src < t_digits; src++) {
-        bool const curr_src_bit_set = mask_bits[src];
+        bool const curr_src_bit_set = ((mask >> src) & 1U) != 0;
         bool const new_stretch = curr_src_bit_set and not prev_src_bit_set;
 
         if (new_stretch) {
-            pack_coefficient.set(dst - src);
+            pack_coefficient |= static_cast<T>(T{1} << (dst - src));
         }
 
         if (curr_src_bit_set) {
@@ -98,9 +247,7 @@ constexpr auto compute_pack_coefficient(std::size_t dst, T const mask) -> T {
         prev_src_bit_set = curr_src_bit_set;
     }
 
-    // FIXME: Check for equivalence
-    return bitset_to_type<T>(pack_coefficient);
-    // return pack_coefficient.template to<T>();
+    return pack_coefficient;
 }
 
 template <typename T> struct mask_bits_t {
@@ -128,6 +275,36 @@ template <typename T>
                                          detail::mask_bits_t<T>{}(Lsb));
 }
 
+/// Portable (constant-evaluable) parallel bit extract. Yields exactly what
+/// _pext_u32/_pext_u64 would, so it's used to build the LUT when the runtime
+/// lookup is going to use the hardware instruction.
+template <typename T>
+[[nodiscard]] constexpr auto soft_pext(T value, T mask) noexcept -> T {
+    auto result = T{};
+    auto dst_bit = T{1};
+    while (mask != 0) {
+        auto const lowest = static_cast<T>(mask & -mask);
+        if ((value & lowest) != 0) {
+            result |= dst_bit;
+        }
+        dst_bit = static_cast<T>(dst_bit << 1);
+        mask = static_cast<T>(mask ^ lowest);
+    }
+    return result;
+}
+
+#if HEUROHASH_USE_BMI2_PEXT
+template <typename T>
+[[nodiscard]] __attribute__((always_inline)) inline auto hw_pext(T value,
+                                                                 T mask) -> T {
+    if constexpr (sizeof(T) <= 4) {
+        return static_cast<T>(_pext_u32(value, mask));
+    } else {
+        return static_cast<T>(_pext_u64(value, mask));
+    }
+}
+#endif
+
 template <typename T> struct pseudo_pext_t {
     T mask;
     T coefficient;
@@ -149,77 +326,252 @@ template <typename T> struct pseudo_pext_t {
 
     [[nodiscard]] constexpr __attribute__((always_inline)) auto
     operator()(T value) const -> T {
+#if HEUROHASH_USE_BMI2_PEXT
+        /* Single instruction at run-time, the LUT is built with the
+         * equivalent software extract */
+        if (std::is_constant_evaluated()) {
+            return soft_pext<T>(value, mask);
+        }
+        return hw_pext<T>(value, mask);
+#else
         auto const packed = (value & mask) * coefficient;
         return static_cast<T>(packed >> gap_bits) & final_mask;
+#endif
     }
 };
 
-/// count the number of key duplicates (n log n)
-template <typename T, std::size_t S>
-constexpr auto count_duplicates(std::array<T, S> keys) -> std::size_t {
-    std::sort(std::begin(keys), std::end(keys));
-    auto dups = std::size_t{};
-    for (auto i = std::adjacent_find(std::cbegin(keys), std::cend(keys));
-         i != std::cend(keys); i = std::adjacent_find(++i, std::cend(keys))) {
-        ++dups;
+/// Multi-word keys: every word is extracted separately & the results are
+/// concatenated into a single index (lowest word in the lowest bits)
+template <std::size_t Words> struct pseudo_pext_t<raw_words_t<Words>> {
+    using word_pext_t = pseudo_pext_t<std::uint64_t>;
+
+    raw_words_t<Words> mask;
+    std::array<word_pext_t, Words> word_pext;
+    std::array<std::uint8_t, Words> word_shift;
+
+    constexpr explicit pseudo_pext_t(raw_words_t<Words> mask_arg)
+        : mask{mask_arg},
+          word_pext{[&]<std::size_t... Is>(std::index_sequence<Is...>) {
+              return std::array<word_pext_t, Words>{word_pext_t{mask[Is]}...};
+          }(std::make_index_sequence<Words>{})},
+          word_shift{} {
+        auto shift = std::size_t{};
+        for (auto i = std::size_t{}; i < Words; ++i) {
+            word_shift[i] = static_cast<std::uint8_t>(shift);
+            shift += static_cast<std::size_t>(std::popcount(mask[i]));
+        }
+    }
+
+    /* Requires the total popcount of mask to be < 64 (i.e. usable as LUT
+     * index) */
+    [[nodiscard]] constexpr __attribute__((always_inline)) auto
+    operator()(raw_words_t<Words> const &value) const -> std::uint64_t {
+        auto result = std::uint64_t{};
+        for (auto i = std::size_t{}; i < Words; ++i) {
+            if (mask[i] != 0) {
+                result |= word_pext[i](value[i]) << word_shift[i];
+            }
+        }
+        return result;
+    }
+};
+
+/// Mask manipulation, uniform over single & multi-word raw keys
+template <typename T> constexpr auto mask_digits() -> std::size_t {
+    if constexpr (is_raw_words<T>::value) {
+        return std::tuple_size_v<T> * 64;
+    } else {
+        return std::numeric_limits<T>::digits;
     }
-    return dups;
 }
 
-/// count the length of the longest run of identical values (n)
-template <typename T, std::size_t S>
-constexpr auto count_longest_run(std::array<T, S> keys) -> std::size_t {
-    std::sort(keys.begin(), keys.end());
+template <typename T> constexpr auto mask_all() -> T {
+    if constexpr (is_raw_words<T>::value) {
+        T mask{};
+        mask.fill(std::numeric_limits<std::uint64_t>::max());
+        return mask;
+    } else {
+        return std::numeric_limits<T>::max();
+    }
+}
 
-    auto longest_run = std::size_t{};
-    auto current_run = std::size_t{};
+template <typename T>
+constexpr auto mask_test(T const &mask, std::size_t bit) -> bool {
+    if constexpr (is_raw_words<T>::value) {
+        return ((mask[bit / 64] >> (bit % 64)) & 1U) != 0;
+    } else {
+        return ((mask >> bit) & 1U) != 0;
+    }
+}
 
-    if (S > 0) {
-        T prev_value = keys[0];
+template <typename T> constexpr auto mask_clear(T mask, std::size_t bit) -> T {
+    if constexpr (is_raw_words<T>::value) {
+        mask[bit / 64] &= ~(std::uint64_t{1} << (bit % 64));
+        return mask;
+    } else {
+        return static_cast<T>(mask & ~static_cast<T>(T{1} << bit));
+    }
+}
+
+template <typename T> constexpr auto mask_set(T mask, std::size_t bit) -> T {
+    if constexpr (is_raw_words<T>::value) {
+        mask[bit / 64] |= std::uint64_t{1} << (bit % 64);
+        return mask;
+    } else {
+        return static_cast<T>(mask | static_cast<T>(T{1} << bit));
+    }
+}
 
-        for (auto i = std::size_t{1}; i < S; i++) {
-            T const curr_value = keys[i];
+template <typename T> constexpr auto mask_and(T value, T const &mask) -> T {
+    if constexpr (is_raw_words<T>::value) {
+        for (auto i = std::size_t{}; i < value.size(); ++i) {
+            value[i] &= mask[i];
+        }
+        return value;
+    } else {
+        return static_cast<T>(value & mask);
+    }
+}
 
-            if (curr_value == prev_value) {
-                current_run++;
+/// Index of the lowest bit in which lhs & rhs differ (mask_digits if equal)
+template <typename T>
+constexpr auto lowest_diff_bit(T const &lhs, T const &rhs) -> std::size_t {
+    if constexpr (is_raw_words<T>::value) {
+        for (auto i = std::size_t{}; i < lhs.size(); ++i) {
+            if (lhs[i] != rhs[i]) {
+                auto const bit = std::countr_zero(lhs[i] ^ rhs[i]);
+                return i * 64 + static_cast<std::size_t>(bit);
             }
+        }
+        return mask_digits<T>();
+    } else {
+        return static_cast<std::size_t>(
+            std::countr_zero(static_cast<T>(lhs ^ rhs)));
+    }
+}
 
-            longest_run = std::max(longest_run, current_run);
-
-            if (curr_value != prev_value) {
-                current_run = 0;
+/// Exact extract of the mask bits (what hardware pext yields), multi-word
+/// values are concatenated the same way pseudo_pext_t does it
+template <typename T>
+constexpr auto exact_pext(T const &value, T const &mask) -> std::uint64_t {
+    if constexpr (is_raw_words<T>::value) {
+        auto result = std::uint64_t{};
+        auto shift = 0;
+        for (auto i = std::size_t{}; i < value.size(); ++i) {
+            if (mask[i] != 0) {
+                result |= soft_pext(value[i], mask[i]) << shift;
+                shift += std::popcount(mask[i]);
             }
+        }
+        return result;
+    } else {
+        return soft_pext<T>(value, mask);
+    }
+}
 
-            prev_value = curr_value;
+template <typename T> constexpr auto mask_popcount(T const &mask) -> int {
+    if constexpr (is_raw_words<T>::value) {
+        auto count = 0;
+        for (auto word : mask) {
+            count += std::popcount(word);
         }
+        return count;
+    } else {
+        return std::popcount(mask);
     }
+}
 
-    return longest_run;
+/// Fibonacci hashing, cheap enough to not dominate constant evaluation
+template <typename T> constexpr auto bucket_hash(T const &v) -> std::uint64_t {
+    constexpr auto golden = std::uint64_t{0x9e3779b97f4a7c15};
+    if constexpr (is_raw_words<T>::value) {
+        auto h = std::uint64_t{};
+        for (auto word : v) {
+            h = (h ^ word) * golden;
+        }
+        return h;
+    } else {
+        return static_cast<std::uint64_t>(v) * golden;
+    }
 }
 
+/// Open addressing occurrence counter. Only used during construction, so
+/// that duplicate counting is linear instead of having to sort the keys.
+/// Slots are tagged with a generation, so reset() is O(1)
+template <typename T> class bucket_counter {
+    struct slot_t {
+        T value;
+        std::size_t count;
+        std::size_t generation;
+    };
+
+    std::vector<slot_t> slots;
+    int slot_shift;
+    std::size_t generation{1};
+
+    constexpr auto slot_of(T const &value) const -> std::size_t {
+        auto const slot_mask = slots.size() - 1;
+        auto slot = static_cast<std::size_t>(bucket_hash(value) >> slot_shift);
+        while (slots[slot].generation == generation &&
+               slots[slot].value != value) {
+            slot = (slot + 1) & slot_mask;
+        }
+        return slot;
+    }
+
+  public:
+    constexpr explicit bucket_counter(std::size_t max_entries)
+        : slots(std::bit_ceil(max_entries * 2 + 2)),
+          slot_shift{64 - std::countr_zero(slots.size())} {}
+
+    /// Returns number of occurrences of value (including these ones)
+    constexpr auto add(T const &value, std::size_t times = 1) -> std::size_t {
+        auto &slot = slots[slot_of(value)];
+        if (slot.generation != generation) {
+            slot = slot_t{value, 0, generation};
+        }
+        return slot.count += times;
+    }
+
+    constexpr auto count(T const &value) const -> std::size_t {
+        auto const &slot = slots[slot_of(value)];
+        return slot.generation == generation ? slot.count : 0;
+    }
+
+    /// Forget all the values (max_entries applies per generation)
+    constexpr void reset() { ++generation; }
+};
+
+/// count the length of the longest run of identical values (n)
 template <typename T, std::size_t S>
-constexpr auto keys_are_unique(std::array<T, S> const &keys) -> bool {
-    return count_duplicates(keys) == 0;
+constexpr auto count_longest_run(std::array<T, S> const &keys) -> std::size_t {
+    auto counter = bucket_counter<T>{S};
+    auto longest_run = std::size_t{};
+    for (auto const &key : keys) {
+        longest_run = std::max(longest_run, counter.add(key) - 1);
+    }
+    return longest_run;
 }
 
+/// (n), stops at the first duplicate
 template <typename T, std::size_t S>
-constexpr auto with_mask(T const mask, std::array<T, S> const &keys)
-    -> std::array<T, S> {
-    std::array<T, S> new_keys{};
-
-    std::transform(keys.begin(), keys.end(), new_keys.begin(),
-                   [&](T k) { return pseudo_pext_t(mask)(k); });
-
-    return new_keys;
+constexpr auto keys_are_unique(std::array<T, S> const &keys) -> bool {
+    auto counter = bucket_counter<T>{S};
+    for (auto const &key : keys) {
+        if (counter.add(key) > 1) {
+            return false;
+        }
+    }
+    return true;
 }
 
 template <typename T, typename V, std::size_t S>
-constexpr bool is_arr_kvp(std::array<std::pair<T, V>, S> const &entries) {
+constexpr bool is_arr_kvp(std::array<std::pair<T, V>, S> const &) {
     return true;
 }
 
 template <typename T, std::size_t S>
-constexpr auto is_arr_kvp(std::array<T, S> const &entries) {
+constexpr auto is_arr_kvp(std::array<T, S> const &) {
     return false;
 }
 
@@ -271,78 +623,291 @@ constexpr auto get_raw_keys(std::array<T, S> const &entries) {
     return new_keys;
 }
 
+/// Try removing each bit from the mask one at a time (most significant first),
+/// keeping it removed if the (exactly) extracted keys are all still unique.
+///
+/// Bit i can't be removed iff two keys agree on all the bits below i and on
+/// the bits kept above i, while differing in bit i. With the keys sorted by
+/// their bit-reversed value, the keys sharing all the bits below i are
+/// contiguous and split in two at the single adjacent pair first differing in
+/// bit i. So each bit only has to compare the halves of the groups that branch
+/// on it, which totals to ~n log n instead of re-hashing all keys per bit
 template <typename T, std::size_t S>
-constexpr auto remove_cheapest_bit(detail::raw_integral_t<T> mask,
-                                   std::array<T, S> keys)
-    -> detail::raw_integral_t<T> {
-    using raw_t = detail::raw_integral_t<T>;
+constexpr auto calc_unique_mask(std::array<T, S> keys) -> T {
+    constexpr auto t_digits = mask_digits<T>();
+    if constexpr (S < 2) {
+        return T{};
+    } else {
+        std::sort(keys.begin(), keys.end(), [](T const &lhs, T const &rhs) {
+            auto const bit = lowest_diff_bit(lhs, rhs);
+            return bit != t_digits && !mask_test(lhs, bit);
+        });
+
+        // adjacent pairs (j, j + 1), bucketed by the bit they split on
+        std::vector<std::size_t> split_bit(S - 1);
+        std::vector<std::size_t> level_start(t_digits + 2);
+        for (auto j = std::size_t{}; j + 1 < S; ++j) {
+            split_bit[j] = lowest_diff_bit(keys[j], keys[j + 1]);
+            ++level_start[split_bit[j] + 1];
+        }
+        std::partial_sum(level_start.begin(), level_start.end(),
+                         level_start.begin());
+        std::vector<std::size_t> splits(S - 1);
+        auto level_fill = level_start;
+        for (auto j = std::size_t{}; j + 1 < S; ++j) {
+            splits[level_fill[split_bit[j]]++] = j;
+        }
 
-    auto const t_digits = std::numeric_limits<raw_t>::digits;
-    auto bmask = std::bitset<t_digits>{mask};
+        auto mask = mask_all<T>();
+        auto kept = T{};
+        auto seen = bucket_counter<T>{S};
+        for (auto x = std::size_t{}; x < t_digits; x++) {
+            auto const i = t_digits - 1 - x;
+            bool conflict = false;
+            for (auto s = level_start[i]; s < level_start[i + 1] && !conflict;
+                 ++s) {
+                // nothing kept above yet, both halves look the same
+                if (kept == T{}) {
+                    conflict = true;
+                    break;
+                }
 
-    auto cheapest_bit = std::size_t{};
-    auto min_num_dups = std::numeric_limits<std::size_t>::max();
+                auto const j = splits[s];
+                auto lo = j;
+                while (lo > 0 && split_bit[lo - 1] >= i) {
+                    --lo;
+                }
+                auto hi = j + 1;
+                while (hi + 1 < S && split_bit[hi] >= i) {
+                    ++hi;
+                }
 
-    for (size_t idx = 0; idx < t_digits; ++idx) {
-        if (!bmask.test(idx)) {
-            continue;
+                seen.reset();
+                for (auto k = lo; k <= j; ++k) {
+                    seen.add(mask_and(keys[k], kept));
+                }
+                for (auto k = j + 1; k <= hi && !conflict; ++k) {
+                    conflict = seen.count(mask_and(keys[k], kept)) != 0;
+                }
+            }
+
+            if (conflict) {
+                kept = mask_set(kept, i);
+            } else {
+                mask = mask_clear(mask, i);
+            }
         }
-        auto btry_mask = bmask;
-        btry_mask.reset(idx);
+        return mask;
+    }
+}
+
+/// Longest run of keys sharing the same pseudo_pext(mask) value, stops
+/// counting once it's over limit
+template <typename T, std::size_t S>
+constexpr auto hashed_longest_run(T const &mask, std::array<T, S> const &keys,
+                                  bucket_counter<std::uint64_t> &counter,
+                                  std::size_t limit) -> std::size_t {
+    auto const p = pseudo_pext_t(mask);
+    auto longest_run = std::size_t{};
+    counter.reset();
+    for (auto const &key : keys) {
+        longest_run = std::max(
+            longest_run, counter.add(static_cast<std::uint64_t>(p(key))) - 1);
+        if (longest_run > limit) {
+            break;
+        }
+    }
+    return longest_run;
+}
+
+/// The multiply based pseudo_pext isn't an exact extract, so keys that are
+/// unique under mask may still be folded together. Put back removed bits
+/// (lowest first) until they are unique under the real hash as well. Usually
+/// takes a couple of tries, none if the hardware pext is used
+template <typename T, std::size_t S>
+constexpr auto repair_unique_mask(T mask, std::array<T, S> const &keys) -> T {
+    auto counter = bucket_counter<std::uint64_t>{S};
+    while (hashed_longest_run(mask, keys, counter, 0) != 0) {
+        auto fallback = mask_digits<T>();
+        auto repaired = false;
+        for (auto i = std::size_t{}; i < mask_digits<T>() && !repaired; ++i) {
+            if (mask_test(mask, i)) {
+                continue;
+            }
+            fallback = std::min(fallback, i);
+            auto const try_mask = mask_set(mask, i);
+            if (hashed_longest_run(try_mask, keys, counter, 0) == 0) {
+                mask = try_mask;
+                repaired = true;
+            }
+        }
+        if (!repaired) {
+            mask = mask_set(mask, fallback);
+        }
+    }
+    return mask;
+}
 
-        std::array<raw_t, S> try_keys =
-            with_mask(bitset_to_type<raw_t>(btry_mask), keys);
+/// Remove the bit causing the fewest collisions, for as long as no bucket
+/// needs more than max_search_len probes (its run, the probes past the first
+/// one, stays under max_search_len). The candidates are ranked on the histogram
+/// of the (exactly) extracted indices, so every candidate bit is a single pass
+/// over the used buckets. Only then they're checked (cheapest first) against
+/// the real hash
+template <typename T, std::size_t S>
+constexpr auto shrink_mask(T mask, std::array<T, S> const &keys,
+                           std::size_t max_search_len) -> T {
+    auto const max_run = max_search_len > 0 ? max_search_len - 1 : 0;
+    auto bits = static_cast<std::size_t>(mask_popcount(mask));
+    // masks of 32+ bits are shrunk as well, only the result has to fit a
+    // lookup table. the histogram indices are 64-bit though
+    if (max_search_len <= 1 || bits <= 4 || bits > 64) {
+        return mask;
+    }
 
-        auto num_dups = count_duplicates(try_keys);
-        if (num_dups < min_num_dups) {
-            min_num_dups = num_dups;
-            cheapest_bit = idx;
+    std::vector<std::size_t> positions;
+    for (auto i = std::size_t{}; i < mask_digits<T>(); ++i) {
+        if (mask_test(mask, i)) {
+            positions.push_back(i);
         }
     }
 
-    bmask.reset(cheapest_bit);
-    return bitset_to_type<raw_t>(bmask);
+    auto run_counter = bucket_counter<std::uint64_t>{S};
+    auto hist = bucket_counter<std::uint64_t>{S};
+    std::vector<std::uint64_t> used;
+    for (auto const &key : keys) {
+        auto const idx = exact_pext(key, mask);
+        if (hist.add(idx) == 1) {
+            used.push_back(idx);
+        }
+    }
+
+    while (bits > 4) {
+        // merging buckets idx & idx | bit only adds a duplicate if both are
+        // in use, so the cheapest bit is the one with the fewest such pairs
+        std::vector<std::pair<std::size_t, std::size_t>> candidates;
+        for (auto t = std::size_t{}; t < bits; ++t) {
+            auto const bit = std::uint64_t{1} << t;
+            auto merged = std::size_t{};
+            for (auto idx : used) {
+                if ((idx & bit) == 0 && hist.count(idx | bit) != 0) {
+                    ++merged;
+                }
+            }
+            candidates.emplace_back(merged, t);
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        // the real hash folds a few more keys together, so the cheapest one
+        // might not fit anymore while the next one still does
+        auto cheapest = bits;
+        auto try_mask = mask;
+        for (auto const &candidate : candidates) {
+            try_mask = mask_clear(mask, positions[candidate.second]);
+            if (hashed_longest_run(try_mask, keys, run_counter, max_run) <=
+                max_run) {
+                cheapest = candidate.second;
+                break;
+            }
+        }
+        if (cheapest == bits) {
+            break;
+        }
+
+        auto const low = (std::uint64_t{1} << cheapest) - 1;
+        auto next_hist = bucket_counter<std::uint64_t>{S};
+        std::vector<std::uint64_t> next_used;
+        for (auto idx : used) {
+            auto const next_idx = (idx & low) | ((idx >> 1) & ~low);
+            auto const count = hist.count(idx);
+            if (next_hist.add(next_idx, count) == count) {
+                next_used.push_back(next_idx);
+            }
+        }
+        hist = std::move(next_hist);
+        used = std::move(next_used);
+
+        mask = try_mask;
+        positions.erase(positions.begin() +
+                        static_cast<std::ptrdiff_t>(cheapest));
+        --bits;
+    }
+    return mask;
+}
+
+/// Smallest mask keeping the keys unique. Masks of 32+ bits aren't repaired
+/// (see repair_unique_mask), shrink_mask only keeps bits removed if the real
+/// hash stays within the search length anyway
+template <typename T, std::size_t S>
+constexpr auto calc_base_mask(std::array<T, S> const &keys) -> T {
+    auto const mask = calc_unique_mask(keys);
+    if (mask_popcount(mask) >= 32) {
+        return mask;
+    }
+    return repair_unique_mask(mask, keys);
 }
 
 template <typename T, std::size_t S>
 constexpr auto calc_pseudo_pext_mask(std::array<T, S> const &input,
                                      std::size_t max_search_len) {
-    auto keys = get_raw_keys(input);
-    using raw_t = decltype(keys)::value_type;
-    auto const t_digits = std::numeric_limits<raw_t>::digits;
+    auto const keys = get_raw_keys(input);
 
-    // try removing each bit from the mask one at a time.
-    // then apply the pseudo_pext function to all the keys with the mask. if
-    // the keys are all still unique, then we can remove the bit and move on
-    // to the next one.
-    raw_t mask = std::numeric_limits<raw_t>::max();
-    for (auto x = std::size_t{}; x < t_digits; x++) {
-        auto i = t_digits - 1 - x;
-        raw_t const try_mask = mask & ~static_cast<raw_t>(raw_t{1} << i);
-        std::array<raw_t, S> const try_keys = with_mask(try_mask, keys);
-        if (keys_are_unique(try_keys)) {
-            mask = try_mask;
-        }
-    }
+    // first the smallest mask for which the keys are still unique
+    auto mask = calc_base_mask(keys);
 
     // we can remove more bits from the mask to achieve a smaller memory
     // footprint with a small runtime cost. each additional bit removed
     // from the mask cuts intermediate table size in half, but risks more
     // collisions. try to remove the most number of bits from the mask while
     // staying under the max search length.
-    auto prev_longest_run = std::size_t{};
-    while (max_search_len > 1 && std::popcount(mask) > 4) {
-        auto try_mask = remove_cheapest_bit(mask, keys);
-        auto current_longest_run = count_longest_run(with_mask(try_mask, keys));
-        if (current_longest_run <= max_search_len) {
-            mask = try_mask;
-            prev_longest_run = current_longest_run;
-        } else {
-            return std::make_tuple(mask, prev_longest_run);
-        }
+    mask = shrink_mask(mask, keys, max_search_len);
+    // still too large for a lookup table, make() reports that
+    if (mask_popcount(mask) >= 32) {
+        return std::make_tuple(mask, std::size_t{});
     }
 
-    return std::make_tuple(mask, prev_longest_run);
+    auto counter = bucket_counter<std::uint64_t>{S};
+    auto const longest_run = hashed_longest_run(
+        mask, keys, counter, std::numeric_limits<std::size_t>::max());
+    return std::make_tuple(mask, longest_run);
+}
+
+/// Max search length in [1, max_search_len] giving the smallest LUT, ties
+/// going to the shorter longest run. Only LUTs of at most lut_budget entries
+/// count as a fit, if none does, the smallest LUT wins
+template <typename T, std::size_t S>
+constexpr auto tune_search_len(std::array<T, S> const &input,
+                               std::size_t max_search_len,
+                               std::size_t lut_budget) -> std::size_t {
+    auto const keys = get_raw_keys(input);
+
+    auto const base = calc_base_mask(keys);
+
+    auto counter = bucket_counter<std::uint64_t>{S};
+    auto best_len = max_search_len;
+    auto best_bits = std::numeric_limits<int>::max();
+    auto best_run = std::numeric_limits<std::size_t>::max();
+    for (auto len = std::size_t{1}; len <= max_search_len; ++len) {
+        auto const mask = shrink_mask(base, keys, len);
+        auto const bits = mask_popcount(mask);
+        if (bits >= 32) {
+            // no lookup table, a longer search might still shrink it enough
+            continue;
+        }
+        auto const run = hashed_longest_run(
+            mask, keys, counter, std::numeric_limits<std::size_t>::max());
+
+        // first length within budget is the one with the fewest probes
+        if ((std::size_t{1} << bits) <= lut_budget) {
+            return len;
+        }
+        if (bits < best_bits || (bits == best_bits && run < best_run)) {
+            best_len = len;
+            best_bits = bits;
+            best_run = run;
+        }
+    }
+    return best_len;
 }
 
 } // namespace detail
@@ -358,9 +923,153 @@ struct dyn_search {
     constexpr auto get() const noexcept { return value; }
 };
 
+/* Everything the lookup of a dense LUT pseudo_next_indirect (below) needs,
+ * with the sizes (LUT width, search length) as run-time values. Lets spans
+ * look keys up inline, instead of calling through a function pointer */
+template <typename KeyT> struct pseudo_next_span_lookup {
+    using raw_key_type = detail::raw_integral_t<KeyT>;
+    using PextFunc = detail::pseudo_pext_t<raw_key_type>;
+
+    const KeyT *keys;
+    const void *lookup_table;
+    PextFunc pext_func;
+    /* log2 of the bytes between keys (entry size if stored interleaved with
+     * values) & per LUT entry (at most 4) */
+    std::uint8_t key_shift;
+    std::uint8_t lut_shift;
+    std::size_t search_len;
+    std::size_t size;
+    /* Bucket bits of a 16 byte vector probe (see simd_probe), 0 if keys
+     * can't be probed that way */
+    std::uint64_t probe_window;
+
+    static constexpr bool simd_probe_possible =
+        detail::raw_is_object_bytes_v<KeyT> &&
+        detail::simd_probe_max_width >= 16;
+
+    [[nodiscard]] constexpr __attribute__((always_inline)) size_t
+    lookup(const KeyT &key) const noexcept {
+        auto const raw_key = detail::as_raw_integral(key);
+        return probe(lut_at(static_cast<size_t>(pext_func(raw_key))), raw_key);
+    }
+
+    /* Same blocking as pseudo_next_indirect::lookup_many, calls
+     * emit(input_idx, found_idx) for every key */
+    static constexpr size_t lookup_block_size = 16;
+
+    template <typename Func>
+    constexpr void lookup_many(const KeyT *in, size_t count,
+                               Func &&emit) const noexcept {
+        std::array<raw_key_type, lookup_block_size> raw_keys{};
+        std::array<size_t, lookup_block_size> starts{};
+
+        for (auto base = std::size_t{0}; base < count;
+             base += lookup_block_size) {
+            auto const block = std::min(lookup_block_size, count - base);
+
+            for (auto i = std::size_t{0}; i < block; ++i) {
+                raw_keys[i] = detail::as_raw_integral(in[base + i]);
+                starts[i] = lut_at(static_cast<size_t>(pext_func(raw_keys[i])));
+                if (!std::is_constant_evaluated()) {
+                    __builtin_prefetch(key_ptr(starts[i]));
+                }
+            }
+
+            for (auto i = std::size_t{0}; i < block; ++i) {
+                emit(base + i, probe(starts[i], raw_keys[i]));
+            }
+        }
+    }
+
+    /* probe_window for the given parameters */
+    static constexpr std::uint64_t make_probe_window(bool packed_keys,
+                                                     std::size_t search_len,
+                                                     std::size_t size) {
+        constexpr auto lanes = 16 / sizeof(raw_key_type);
+        constexpr auto bits_per_lane =
+            sizeof(raw_key_type) * detail::simd_probe_bits_per_byte;
+        if (!simd_probe_possible || !packed_keys || search_len < 2 ||
+            search_len > lanes || size < lanes) {
+            return 0;
+        }
+        auto const bits = search_len * bits_per_lane;
+        return bits >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << bits) - 1;
+    }
+
+  private:
+    [[nodiscard]] constexpr __attribute__((always_inline)) size_t
+    probe(size_t start, raw_key_type raw_key) const noexcept {
+        if constexpr (simd_probe_possible) {
+            if (probe_window != 0 && !std::is_constant_evaluated()) {
+                return simd_probe(start, raw_key);
+            }
+        }
+        return scalar_probe(start, raw_key);
+    }
+
+    /* Runtime sized variant of detail::simd_probe */
+    [[nodiscard]] __attribute__((always_inline)) size_t
+    simd_probe(size_t start, raw_key_type raw_key) const noexcept {
+        constexpr auto lanes = 16 / sizeof(raw_key_type);
+        constexpr auto bits_per_lane =
+            sizeof(raw_key_type) * detail::simd_probe_bits_per_byte;
+        auto const load_start = start < size - lanes ? start : size - lanes;
+        /* Keys are packed (probe_window is 0 otherwise) & stored as their
+         * raw value, so lanes are sizeof(raw_key_type) bytes apart */
+        auto const match = detail::simd_probe_match<raw_key_type, 16>(
+            reinterpret_cast<const char *>(keys) +
+                load_start * sizeof(raw_key_type),
+            raw_key);
+        auto const hits =
+            match & (probe_window << ((start - load_start) * bits_per_lane));
+        if (hits == 0) {
+            return size;
+        }
+        return load_start +
+               static_cast<size_t>(std::countr_zero(hits)) / bits_per_lane;
+    }
+
+    [[nodiscard]] constexpr size_t
+    scalar_probe(size_t start, raw_key_type raw_key) const noexcept {
+        /* Keys are unique, so at most one matches. Checking the whole bucket
+         * with a masked select (GCC emits a branch for ?: here), instead of
+         * stopping at the match, keeps its position from being mispredicted */
+        auto found = size;
+        for (auto i = start; i < start + search_len; ++i) {
+            auto const hit = static_cast<size_t>(raw_key == raw_key_at(i));
+            found ^= (found ^ i) & (size_t{0} - hit);
+        }
+        return found;
+    }
+
+    [[nodiscard]] constexpr __attribute__((always_inline)) size_t
+    lut_at(size_t idx) const noexcept {
+        /* Same width for every lookup, so well predicted */
+        if (lut_shift == 0) {
+            return static_cast<const std::uint8_t *>(lookup_table)[idx];
+        }
+        if (lut_shift == 1) {
+            return static_cast<const std::uint16_t *>(lookup_table)[idx];
+        }
+        return static_cast<const std::uint32_t *>(lookup_table)[idx];
+    }
+
+    [[nodiscard]] constexpr __attribute__((always_inline)) const KeyT *
+    key_ptr(size_t i) const noexcept {
+        return reinterpret_cast<const KeyT *>(
+            reinterpret_cast<const char *>(keys) + (i << key_shift));
+    }
+
+    [[nodiscard]] constexpr __attribute__((always_inline)) raw_key_type
+    raw_key_at(size_t i) const noexcept {
+        return detail::as_raw_integral(*key_ptr(i));
+    }
+};
+
 template <typename StorageT, typename LookupTableT, size_t SearchLen = 0>
 struct pseudo_next_indirect {
-    using key_type = StorageT::value_type;
+    using entry_type = StorageT::value_type;
+    using key_type = detail::entry_key_t<entry_type>;
     using storage_t = std::remove_cv_t<StorageT>;
     using raw_key_type = detail::raw_integral_t<key_type>;
 
@@ -369,9 +1078,19 @@ struct pseudo_next_indirect {
                                             empty_dyn_search<SearchLen>>;
 
     using PextFunc = detail::pseudo_pext_t<raw_key_type>;
+    using lut_type = LookupTableT;
 
     static constexpr auto search_len_v = SearchLen;
 
+    /* Size of key storage, if known at compile time (0 otherwise) */
+    static constexpr size_t static_size_v = []() {
+        if constexpr (requires { std::tuple_size<storage_t>::value; }) {
+            return std::tuple_size_v<storage_t>;
+        } else {
+            return size_t{0};
+        }
+    }();
+
     /* AoT-known case */
     constexpr pseudo_next_indirect(StorageT storage, LookupTableT lookup_table,
                                    PextFunc func) noexcept
@@ -399,11 +1118,32 @@ struct pseudo_next_indirect {
     [[nodiscard]] constexpr __attribute__((always_inline)) size_t
     lookup(key_type key) const noexcept {
         auto const raw_key = detail::as_raw_integral(key);
-        auto i = lookup_table[pext_func(raw_key)];
+        return probe(raw_key, lookup_table[pext_func(raw_key)]);
+    }
+
+    [[nodiscard]] constexpr __attribute__((always_inline)) raw_key_type
+    raw_key_at(size_t i) const noexcept {
+        return detail::as_raw_integral(detail::entry_key(key_storage[i]));
+    }
+
+    /* Verify bucket starting at i (up to search_len entries) */
+    [[nodiscard]] constexpr __attribute__((always_inline)) size_t
+    probe(raw_key_type raw_key, size_t i) const noexcept {
         if constexpr (SearchLen != 0) {
+            /* Whole run in a single vector compare */
+            if constexpr (!detail::is_kv_entry_v<entry_type> &&
+                          detail::raw_is_object_bytes_v<key_type> &&
+                          detail::simd_probe_usable_v<SearchLen, static_size_v,
+                                                      raw_key_type>) {
+                if (!std::is_constant_evaluated()) {
+                    return detail::simd_probe<SearchLen, static_size_v>(
+                        key_storage.data(), i, raw_key);
+                }
+            }
+
             for (auto search_count = std::size_t{0}; search_count < SearchLen;
                  ++search_count) {
-                if (raw_key == detail::as_raw_integral(key_storage[i])) {
+                if (raw_key == raw_key_at(i)) {
                     return i;
                 }
 
@@ -413,7 +1153,7 @@ struct pseudo_next_indirect {
             auto const max_len = search_len.get();
             for (auto search_count = std::size_t{0}; search_count < max_len;
                  ++search_count) {
-                if (raw_key == detail::as_raw_integral(key_storage[i])) {
+                if (raw_key == raw_key_at(i)) {
                     return i;
                 }
                 ++i;
@@ -423,20 +1163,85 @@ struct pseudo_next_indirect {
         return key_storage.size();
     }
 
+    /* Keys are processed in blocks: first every key of the block is hashed &
+     * its LUT entry loaded, only then are the buckets verified. This way the
+     * LUT & key storage loads of different keys don't depend on each other,
+     * so the CPU can have several misses in flight at once */
+    static constexpr size_t lookup_block_size = 16;
+
+    /* Calls emit(input_idx, found_idx) for every key */
+    template <typename Func>
+    constexpr void lookup_many(const key_type *keys, size_t count,
+                               Func &&emit) const noexcept {
+        std::array<raw_key_type, lookup_block_size> raw_keys{};
+        std::array<size_t, lookup_block_size> starts{};
+
+        for (auto base = std::size_t{0}; base < count;
+             base += lookup_block_size) {
+            auto const block = std::min(lookup_block_size, count - base);
+
+            for (auto i = std::size_t{0}; i < block; ++i) {
+                raw_keys[i] = detail::as_raw_integral(keys[base + i]);
+            }
+
+            for (auto i = std::size_t{0}; i < block; ++i) {
+                starts[i] = lookup_table[pext_func(raw_keys[i])];
+                if (!std::is_constant_evaluated()) {
+                    __builtin_prefetch(key_storage.data() + starts[i]);
+                }
+            }
+
+            for (auto i = std::size_t{0}; i < block; ++i) {
+                emit(base + i, probe(raw_keys[i], starts[i]));
+            }
+        }
+    }
+
     constexpr size_t find(key_type key) const noexcept { return lookup(key); }
 
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<size_t> out) const noexcept {
+        lookup_many(in.data(), in.size(),
+                    [&](size_t i, size_t idx) { out[i] = idx; });
+    }
+
     constexpr size_t size() const noexcept { return key_storage.size(); }
     constexpr size_t lut_size() const noexcept { return lookup_table.size(); }
     constexpr size_t depth() const noexcept { return search_len.get(); }
 
     constexpr const key_type *begin() const noexcept {
-        return key_storage.data();
+        if constexpr (detail::is_kv_entry_v<entry_type>) {
+            return &key_storage.data()->key;
+        } else {
+            return key_storage.data();
+        }
     }
 
-    /* Allow conversion to dyn size if AoT type */
+    /* Lookup parameters for spans (see pseudo_next_span_lookup), dense LUTs
+     * & power of two sized entries only */
+    [[nodiscard]] constexpr auto span_lookup() const noexcept
+        requires(SearchLen != 0 && detail::is_dense_lut_v<LookupTableT> &&
+                 sizeof(typename LookupTableT::value_type) <= 4 &&
+                 std::has_single_bit(sizeof(entry_type)))
+    {
+        return pseudo_next_span_lookup<key_type>{
+            begin(),
+            lookup_table.data(),
+            pext_func,
+            static_cast<std::uint8_t>(std::countr_zero(sizeof(entry_type))),
+            static_cast<std::uint8_t>(std::countr_zero(
+                sizeof(typename LookupTableT::value_type))),
+            SearchLen,
+            size(),
+            pseudo_next_span_lookup<key_type>::make_probe_window(
+                !detail::is_kv_entry_v<entry_type>, SearchLen, size())};
+    }
+
+    /* Allow conversion to dyn size if AoT type. Spans address the LUT
+     * directly, so compressed LUTs can't be converted */
     [[nodiscard]] constexpr pseudo_next_indirect<StorageT, LookupTableT, 0>
     to_dyn() const noexcept
-        requires(SearchLen != 0)
+        requires(SearchLen != 0 && detail::is_dense_lut_v<LookupTableT>)
     {
         return pseudo_next_indirect{
             std::span{key_storage.data(), key_storage.size()},
@@ -445,7 +1250,7 @@ struct pseudo_next_indirect {
     }
 
     [[nodiscard]] constexpr auto to_dyn_lut() const noexcept
-        requires(SearchLen != 0)
+        requires(SearchLen != 0 && detail::is_dense_lut_v<LookupTableT>)
     {
         auto lookup_table_span =
             std::span{lookup_table.data(), lookup_table.size()};
@@ -461,7 +1266,42 @@ using dyn_pseudo_next_indirect =
 
 template <size_t MaxSize> using lookup_idx_exp_t = detail::uint_for_<MaxSize>;
 
-template <std::size_t MaxSearchLen = 4> struct pseudo_pext_lookup {
+/* Search length policies, pick MaxSearchLen of pseudo_pext_lookup for a key
+ * set. Longer searches allow for a smaller LUT */
+/// Fixed max search length
+template <std::size_t MaxSearchLen> struct fixed_search_len {
+    template <typename T, std::size_t S>
+    static constexpr auto max_search_len(std::array<T, S> const &) noexcept {
+        return MaxSearchLen;
+    }
+};
+
+/// Shortest max search length (up to MaxSearchLen) with a LUT of at most
+/// LutBudget entries. Falls back to the smallest LUT if none fits
+template <std::size_t LutBudget, std::size_t MaxSearchLen = 8>
+struct lut_budget {
+    template <typename T, std::size_t S>
+    static constexpr auto max_search_len(std::array<T, S> const &input) {
+        return detail::tune_search_len(input, MaxSearchLen, LutBudget);
+    }
+};
+
+/// Evaluates max search lengths up to MaxSearchLen, picking the one with the
+/// smallest LUT
+template <std::size_t MaxSearchLen = 4> struct min_memory {
+    template <typename T, std::size_t S>
+    static constexpr auto max_search_len(std::array<T, S> const &input) {
+        return detail::tune_search_len(input, MaxSearchLen, 0);
+    }
+};
+
+/// Single entry buckets wherever possible, at the cost of LUT size
+using min_probes = fixed_search_len<1>;
+
+/// LutPolicy selects the LUT representation (see compressed_lut.hpp)
+template <std::size_t MaxSearchLen = 4,
+          typename LutPolicy = dense_lut_policy>
+struct pseudo_pext_lookup {
   private:
     static_assert(MaxSearchLen >= 1);
 
@@ -480,16 +1320,25 @@ template <std::size_t MaxSearchLen = 4> struct pseudo_pext_lookup {
         constexpr auto search_len = std::get<1>(mask_and_search) + 1;
 
         constexpr auto p = detail::pseudo_pext_t(mask);
-        constexpr auto lookup_table_size = 1 << std::popcount(mask);
+        static_assert(detail::mask_popcount(mask) < 32,
+                      "Lookup table would be too large");
+        constexpr auto lookup_table_size = 1 << detail::mask_popcount(mask);
 
         constexpr auto storage = [&]() {
-            auto s = detail::get_orig_keys(input);
-
-            // sort by the hashed key to group all the buckets together
-            std::sort(s.begin(), s.end(), [&](auto left, auto right) {
-                return p(detail::as_raw_integral(left)) <
-                       p(detail::as_raw_integral(right));
-            });
+            auto const orig = detail::get_orig_keys(input);
+            auto s = decltype(orig){};
+
+            // bucket by the hashed key to group all the buckets together
+            // (counting sort, hashed keys are all < lookup_table_size)
+            std::vector<std::size_t> bucket_pos(lookup_table_size + 1);
+            for (auto const &key : orig) {
+                ++bucket_pos[p(detail::as_raw_integral(key)) + 1];
+            }
+            std::partial_sum(bucket_pos.begin(), bucket_pos.end(),
+                             bucket_pos.begin());
+            for (auto const &key : orig) {
+                s[bucket_pos[p(detail::as_raw_integral(key))]++] = key;
+            }
 
             // find end of the longest bucket
             auto const end_of_longest_bucket = [&]() {
@@ -543,9 +1392,46 @@ template <std::size_t MaxSearchLen = 4> struct pseudo_pext_lookup {
             return t;
         }();
 
+        constexpr auto is_rank_lut =
+            std::is_same_v<LutPolicy, rank_lut_policy>;
+
+        // occupied LUT slots, only needed by the rank LUT
+        [[maybe_unused]] constexpr auto used_slots = [&]() {
+            std::array<std::uint64_t,
+                       is_rank_lut ? (lookup_table_size + 63) / 64 : 0>
+                used{};
+            if constexpr (is_rank_lut) {
+                for (auto const &key : storage) {
+                    auto const idx = p(detail::as_raw_integral(key));
+                    used[idx / 64] |= std::uint64_t{1} << (idx % 64);
+                }
+            }
+            return used;
+        }();
+
+        constexpr auto lut = [&]() {
+            if constexpr (std::is_same_v<LutPolicy, bit_packed_lut_policy>) {
+                return bit_packed_lut<lookup_table_size, storage.size()>{
+                    lookup_table};
+            } else if constexpr (is_rank_lut) {
+                constexpr auto used_count = std::accumulate(
+                    used_slots.begin(), used_slots.end(), std::size_t{},
+                    [](std::size_t sum, std::uint64_t word) {
+                        return sum + static_cast<std::size_t>(
+                                         std::popcount(word));
+                    });
+                return rank_lut<lookup_table_size, used_count,
+                                detail::uint_for_<storage.size()>,
+                                detail::uint_for_<used_count>>{lookup_table,
+                                                               used_slots};
+            } else {
+                return lookup_table;
+            }
+        }();
+
         return pseudo_next_indirect<std::remove_cv_t<decltype(storage)>,
-                                    std::remove_cv_t<decltype(lookup_table)>,
-                                    search_len>{storage, lookup_table, p};
+                                    std::remove_cv_t<decltype(lut)>,
+                                    search_len>{storage, lut, p};
     }
 };
 } // namespace lookup
@@ -0,0 +1,161 @@
+#pragma once
+
+/*
+ * Vectorized node rank for stree_search.
+ *
+ * Counts how many keys of a (cache line sized) S-tree node are less than the
+ * searched key: the node is compared against the broadcast key one vector at a
+ * time and the resulting masks are popcounted. Unsigned keys are compared with
+ * their sign bit flipped where only signed compares exist.
+ *
+ * Can be disabled by defining HEUROHASH_DISABLE_SIMD_PROBE
+ */
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if !defined(HEUROHASH_DISABLE_SIMD_PROBE) && defined(__AVX512F__)
+#define HEUROHASH_SIMD_RANK_WIDTH 64
+#include <immintrin.h>
+#elif !defined(HEUROHASH_DISABLE_SIMD_PROBE) && defined(__AVX2__)
+#define HEUROHASH_SIMD_RANK_WIDTH 32
+#include <immintrin.h>
+#elif !defined(HEUROHASH_DISABLE_SIMD_PROBE) && defined(__SSE2__)
+#define HEUROHASH_SIMD_RANK_WIDTH 16
+#include <emmintrin.h>
+#elif !defined(HEUROHASH_DISABLE_SIMD_PROBE) && defined(__ARM_NEON) &&        \
+    defined(__aarch64__)
+#define HEUROHASH_SIMD_RANK_WIDTH 16
+#include <arm_neon.h>
+#else
+#define HEUROHASH_SIMD_RANK_WIDTH 0
+#endif
+
+namespace heurohash::detail {
+
+/// Vector width (in bytes) used for ranking a node (0 if none)
+inline constexpr std::size_t simd_rank_width = HEUROHASH_SIMD_RANK_WIDTH;
+
+#if HEUROHASH_SIMD_RANK_WIDTH >= 32 || defined(__ARM_NEON)
+inline constexpr bool simd_rank_64bit = true;
+#else
+/* 64-bit compares need SSE4.2 on x86, only take AVX2 & up */
+inline constexpr bool simd_rank_64bit = false;
+#endif
+
+/// Whether simd_node_rank supports keys of type RawT
+template <typename RawT>
+inline constexpr bool simd_rank_usable_v =
+    simd_rank_width != 0 && std::is_integral_v<RawT> &&
+    !std::is_same_v<RawT, bool> &&
+    (sizeof(RawT) == 4 || (sizeof(RawT) == 8 && simd_rank_64bit));
+
+/// Number of keys in node[0, NodeBytes / sizeof(RawT)) less than key
+template <typename RawT, std::size_t NodeBytes>
+[[nodiscard]] inline __attribute__((always_inline)) std::size_t
+simd_node_rank(const RawT *node, RawT key) noexcept {
+    static_assert(simd_rank_usable_v<RawT>);
+#if HEUROHASH_SIMD_RANK_WIDTH != 0
+    static_assert(NodeBytes % simd_rank_width == 0);
+#endif
+    constexpr auto key_bytes = sizeof(RawT);
+    constexpr auto is_signed = std::is_signed_v<RawT>;
+
+    auto rank = std::size_t{0};
+#if HEUROHASH_SIMD_RANK_WIDTH == 64
+    auto const keyv = key_bytes == 4
+                          ? _mm512_set1_epi32(static_cast<int>(key))
+                          : _mm512_set1_epi64(static_cast<long long>(key));
+    for (std::size_t off = 0; off < NodeBytes; off += 64) {
+        auto const data = _mm512_loadu_si512(
+            reinterpret_cast<const std::byte *>(node) + off);
+        if constexpr (key_bytes == 4 && is_signed) {
+            rank += std::popcount(
+                static_cast<unsigned>(_mm512_cmplt_epi32_mask(data, keyv)));
+        } else if constexpr (key_bytes == 4) {
+            rank += std::popcount(
+                static_cast<unsigned>(_mm512_cmplt_epu32_mask(data, keyv)));
+        } else if constexpr (is_signed) {
+            rank += std::popcount(
+                static_cast<unsigned>(_mm512_cmplt_epi64_mask(data, keyv)));
+        } else {
+            rank += std::popcount(
+                static_cast<unsigned>(_mm512_cmplt_epu64_mask(data, keyv)));
+        }
+    }
+#elif HEUROHASH_SIMD_RANK_WIDTH == 32
+    /* Only signed compares, flip the sign bit of unsigned keys */
+    auto const flip = is_signed ? _mm256_setzero_si256()
+                      : key_bytes == 4
+                          ? _mm256_set1_epi32(INT32_MIN)
+                          : _mm256_set1_epi64x(INT64_MIN);
+    auto const keyv = _mm256_xor_si256(
+        key_bytes == 4 ? _mm256_set1_epi32(static_cast<int>(key))
+                       : _mm256_set1_epi64x(static_cast<long long>(key)),
+        flip);
+    for (std::size_t off = 0; off < NodeBytes; off += 32) {
+        auto const data = _mm256_xor_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(
+                reinterpret_cast<const std::byte *>(node) + off)),
+            flip);
+        auto const lt = key_bytes == 4 ? _mm256_cmpgt_epi32(keyv, data)
+                                       : _mm256_cmpgt_epi64(keyv, data);
+        rank += static_cast<std::size_t>(std::popcount(
+                    static_cast<std::uint32_t>(_mm256_movemask_epi8(lt)))) /
+                key_bytes;
+    }
+#elif HEUROHASH_SIMD_RANK_WIDTH == 16 && !defined(__ARM_NEON)
+    static_assert(key_bytes == 4);
+    auto const flip =
+        is_signed ? _mm_setzero_si128() : _mm_set1_epi32(INT32_MIN);
+    auto const keyv =
+        _mm_xor_si128(_mm_set1_epi32(static_cast<int>(key)), flip);
+    for (std::size_t off = 0; off < NodeBytes; off += 16) {
+        auto const data = _mm_xor_si128(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+                reinterpret_cast<const std::byte *>(node) + off)),
+            flip);
+        rank += static_cast<std::size_t>(std::popcount(static_cast<unsigned>(
+                    _mm_movemask_epi8(_mm_cmpgt_epi32(keyv, data))))) /
+                4;
+    }
+#elif HEUROHASH_SIMD_RANK_WIDTH == 16
+    /* Lanes that compare true are all ones (-1), sum them up & negate */
+    constexpr auto lanes = 16 / key_bytes;
+    for (std::size_t i = 0; i < NodeBytes / key_bytes; i += lanes) {
+        if constexpr (key_bytes == 4 && is_signed) {
+            auto const lt = vcltq_s32(
+                vld1q_s32(reinterpret_cast<const std::int32_t *>(node) + i),
+                vdupq_n_s32(key));
+            rank += static_cast<std::size_t>(
+                -vaddvq_s32(vreinterpretq_s32_u32(lt)));
+        } else if constexpr (key_bytes == 4) {
+            auto const lt = vcltq_u32(
+                vld1q_u32(reinterpret_cast<const std::uint32_t *>(node) + i),
+                vdupq_n_u32(key));
+            rank += static_cast<std::size_t>(
+                -vaddvq_s32(vreinterpretq_s32_u32(lt)));
+        } else if constexpr (is_signed) {
+            auto const lt = vcltq_s64(
+                vld1q_s64(reinterpret_cast<const std::int64_t *>(node) + i),
+                vdupq_n_s64(key));
+            rank += static_cast<std::size_t>(
+                -vaddvq_s64(vreinterpretq_s64_u64(lt)));
+        } else {
+            auto const lt = vcltq_u64(
+                vld1q_u64(reinterpret_cast<const std::uint64_t *>(node) + i),
+                vdupq_n_u64(key));
+            rank += static_cast<std::size_t>(
+                -vaddvq_s64(vreinterpretq_s64_u64(lt)));
+        }
+    }
+#else
+    static_cast<void>(node);
+    static_cast<void>(key);
+#endif
+    return rank;
+}
+
+} // namespace heurohash::detail
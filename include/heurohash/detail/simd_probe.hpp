@@ -0,0 +1,170 @@
+#pragma once
+
+/*
+ * Vectorized bucket probe for pseudo_next_indirect.
+ *
+ * Instead of comparing the candidate run key by key, the whole run is loaded
+ * into a single vector register, compared against the broadcast key and
+ * reduced to a bitmask. The load is clamped so that it never goes past the end
+ * of the key storage (the run itself is already guaranteed to be in-bounds),
+ * which avoids having to pad the storage.
+ *
+ * Can be disabled by defining HEUROHASH_DISABLE_SIMD_PROBE
+ */
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if !defined(HEUROHASH_DISABLE_SIMD_PROBE) && defined(__AVX2__)
+#define HEUROHASH_SIMD_PROBE_WIDTH 32
+#include <immintrin.h>
+#elif !defined(HEUROHASH_DISABLE_SIMD_PROBE) && defined(__SSE2__)
+#define HEUROHASH_SIMD_PROBE_WIDTH 16
+#include <emmintrin.h>
+#elif !defined(HEUROHASH_DISABLE_SIMD_PROBE) && defined(__ARM_NEON) &&        \
+    defined(__aarch64__)
+#define HEUROHASH_SIMD_PROBE_WIDTH 16
+#include <arm_neon.h>
+#else
+#define HEUROHASH_SIMD_PROBE_WIDTH 0
+#endif
+
+namespace lookup::detail {
+
+/// Widest vector (in bytes) that can be compared in one go (0 if none)
+inline constexpr std::size_t simd_probe_max_width = HEUROHASH_SIMD_PROBE_WIDTH;
+
+#if defined(__ARM_NEON) && HEUROHASH_SIMD_PROBE_WIDTH != 0
+/* NEON has no movemask, narrowing shift gives 4 bits per byte instead */
+inline constexpr std::size_t simd_probe_bits_per_byte = 4;
+#else
+inline constexpr std::size_t simd_probe_bits_per_byte = 1;
+#endif
+
+/// Smallest supported vector width fitting `bytes`, 0 if none does
+[[nodiscard]] constexpr std::size_t simd_probe_width_for(std::size_t bytes) {
+    if (bytes <= 16 && simd_probe_max_width >= 16) {
+        return 16;
+    }
+    if (bytes <= 32 && simd_probe_max_width >= 32) {
+        return 32;
+    }
+    return 0;
+}
+
+/// Compares Width bytes at ptr against the broadcast key. Every lane that
+/// matches sets sizeof(RawT) * simd_probe_bits_per_byte bits of the result
+template <typename RawT, std::size_t Width>
+[[nodiscard]] inline __attribute__((always_inline)) std::uint64_t
+simd_probe_match(const void *ptr, RawT key) noexcept {
+    static_assert(Width != 0 && Width <= simd_probe_max_width);
+    constexpr auto key_bytes = sizeof(RawT);
+
+#if HEUROHASH_SIMD_PROBE_WIDTH != 0 && !defined(__ARM_NEON)
+    if constexpr (Width == 16) {
+        auto const data =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+        __m128i eq;
+        if constexpr (key_bytes == 1) {
+            eq = _mm_cmpeq_epi8(data, _mm_set1_epi8(static_cast<char>(key)));
+        } else if constexpr (key_bytes == 2) {
+            eq = _mm_cmpeq_epi16(data,
+                                 _mm_set1_epi16(static_cast<short>(key)));
+        } else if constexpr (key_bytes == 4) {
+            eq = _mm_cmpeq_epi32(data, _mm_set1_epi32(static_cast<int>(key)));
+        } else {
+            /* No 64-bit compare in SSE2, both 32-bit halves must match */
+            auto const eq32 = _mm_cmpeq_epi32(
+                data, _mm_set1_epi64x(static_cast<long long>(key)));
+            eq = _mm_and_si128(eq32, _mm_shuffle_epi32(eq32, 0xB1));
+        }
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(eq));
+    }
+#if HEUROHASH_SIMD_PROBE_WIDTH >= 32
+    else {
+        auto const data =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+        __m256i eq;
+        if constexpr (key_bytes == 1) {
+            eq = _mm256_cmpeq_epi8(data,
+                                   _mm256_set1_epi8(static_cast<char>(key)));
+        } else if constexpr (key_bytes == 2) {
+            eq = _mm256_cmpeq_epi16(
+                data, _mm256_set1_epi16(static_cast<short>(key)));
+        } else if constexpr (key_bytes == 4) {
+            eq = _mm256_cmpeq_epi32(data,
+                                    _mm256_set1_epi32(static_cast<int>(key)));
+        } else {
+            eq = _mm256_cmpeq_epi64(
+                data, _mm256_set1_epi64x(static_cast<long long>(key)));
+        }
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(eq));
+    }
+#endif
+#elif HEUROHASH_SIMD_PROBE_WIDTH != 0
+    auto const *bytes = static_cast<const std::uint8_t *>(ptr);
+    uint8x16_t eq;
+    if constexpr (key_bytes == 1) {
+        eq = vceqq_u8(vld1q_u8(bytes), vdupq_n_u8(key));
+    } else if constexpr (key_bytes == 2) {
+        eq = vreinterpretq_u8_u16(vceqq_u16(
+            vreinterpretq_u16_u8(vld1q_u8(bytes)), vdupq_n_u16(key)));
+    } else if constexpr (key_bytes == 4) {
+        eq = vreinterpretq_u8_u32(vceqq_u32(
+            vreinterpretq_u32_u8(vld1q_u8(bytes)), vdupq_n_u32(key)));
+    } else {
+        eq = vreinterpretq_u8_u64(vceqq_u64(
+            vreinterpretq_u64_u8(vld1q_u8(bytes)), vdupq_n_u64(key)));
+    }
+    auto const narrowed = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+#else
+    static_cast<void>(ptr);
+    static_cast<void>(key);
+    return 0;
+#endif
+}
+
+/// Index of key within keys[start, start + SearchLen), or Size if missing.
+/// Requires start + SearchLen <= Size.
+template <std::size_t SearchLen, std::size_t Size, typename RawT>
+[[nodiscard]] inline __attribute__((always_inline)) std::size_t
+simd_probe(const void *keys, std::size_t start, RawT key) noexcept {
+    constexpr auto key_bytes = sizeof(RawT);
+    constexpr auto width = simd_probe_width_for(SearchLen * key_bytes);
+    constexpr auto lanes = width / key_bytes;
+    constexpr auto bits_per_lane = key_bytes * simd_probe_bits_per_byte;
+    constexpr auto window_bits = SearchLen * bits_per_lane;
+    static_assert(width != 0 && lanes <= Size);
+
+    constexpr auto window_mask = window_bits >= 64
+                                     ? ~std::uint64_t{0}
+                                     : (std::uint64_t{1} << window_bits) - 1;
+
+    /* Clamp the load to the end of the storage, the run is still covered
+     * since start + SearchLen <= Size */
+    auto const load_start = start < Size - lanes ? start : Size - lanes;
+    auto const *base = static_cast<const std::byte *>(keys);
+    auto const match = simd_probe_match<RawT, width>(
+        base + load_start * key_bytes, key);
+    auto const hits =
+        match & (window_mask << ((start - load_start) * bits_per_lane));
+
+    if (hits == 0) {
+        return Size;
+    }
+    return load_start +
+           static_cast<std::size_t>(std::countr_zero(hits)) / bits_per_lane;
+}
+
+/// Whether simd_probe can be used for the given (compile-time) parameters.
+/// The keys must be stored as RawT in memory, the caller checks that
+template <std::size_t SearchLen, std::size_t Size, typename RawT>
+inline constexpr bool simd_probe_usable_v =
+    std::is_integral_v<RawT> && SearchLen >= 2 &&
+    simd_probe_width_for(SearchLen * sizeof(RawT)) != 0 &&
+    simd_probe_width_for(SearchLen * sizeof(RawT)) / sizeof(RawT) <= Size;
+
+} // namespace lookup::detail
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace heurohash::detail {
+/// Iterator over keys kept in a single character pool, key i being
+/// pool[offsets[i], offsets[i + 1]). Dereferences to a std::string_view (by
+/// value), so it stands in for the key pointers of other keysets. Offsets are
+/// always 32-bit, so that spans over any string keyset share this type
+class string_key_iterator {
+    const char *pool = nullptr;
+    const std::uint32_t *offsets = nullptr;
+
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::string_view;
+    using reference = std::string_view;
+    using pointer = void;
+
+    constexpr string_key_iterator() noexcept = default;
+
+    constexpr string_key_iterator(const char *pool,
+                                  const std::uint32_t *offsets) noexcept
+        : pool(pool), offsets(offsets) {}
+
+    constexpr reference operator*() const noexcept {
+        return std::string_view{pool + offsets[0], offsets[1] - offsets[0]};
+    }
+
+    constexpr reference operator[](difference_type n) const noexcept {
+        return *(*this + n);
+    }
+
+    constexpr string_key_iterator &operator++() noexcept { return *this += 1; }
+
+    constexpr string_key_iterator operator++(int) noexcept {
+        auto tmp = *this;
+        ++(*this);
+        return tmp;
+    }
+
+    constexpr string_key_iterator &operator--() noexcept { return *this -= 1; }
+
+    constexpr string_key_iterator operator--(int) noexcept {
+        auto tmp = *this;
+        --(*this);
+        return tmp;
+    }
+
+    constexpr string_key_iterator &operator+=(difference_type n) noexcept {
+        offsets += n;
+        return *this;
+    }
+
+    constexpr string_key_iterator &operator-=(difference_type n) noexcept {
+        offsets -= n;
+        return *this;
+    }
+
+    constexpr string_key_iterator operator+(difference_type n) const noexcept {
+        return string_key_iterator{pool, offsets + n};
+    }
+
+    friend constexpr string_key_iterator
+    operator+(difference_type n, const string_key_iterator &it) noexcept {
+        return it + n;
+    }
+
+    constexpr string_key_iterator operator-(difference_type n) const noexcept {
+        return string_key_iterator{pool, offsets - n};
+    }
+
+    constexpr difference_type
+    operator-(const string_key_iterator &other) const noexcept {
+        return offsets - other.offsets;
+    }
+
+    constexpr auto
+    operator<=>(const string_key_iterator &other) const noexcept {
+        return offsets <=> other.offsets;
+    }
+
+    constexpr bool
+    operator==(const string_key_iterator &other) const noexcept {
+        return offsets == other.offsets;
+    }
+};
+} // namespace heurohash::detail
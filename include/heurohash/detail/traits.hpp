@@ -1,5 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
 #include <type_traits>
 #include <cassert>
 
@@ -9,4 +14,95 @@ namespace heurohash::detail {
 template <typename T>
 using underlying_type = typename std::remove_cv_t<std::conditional_t<
     std::is_enum_v<T>, std::underlying_type<T>, std::type_identity<T>>>::type;
-};
\ No newline at end of file
+
+inline constexpr std::size_t cache_line_size = 64;
+
+/// Narrowest unsigned type holding an index into Size entries, or Size itself
+/// (the not found sentinel)
+template <std::size_t Size>
+using ordered_index_t = std::conditional_t<
+    (Size < UINT8_MAX), std::uint8_t,
+    std::conditional_t<(Size < UINT16_MAX), std::uint16_t,
+                       std::conditional_t<(Size < UINT32_MAX), std::uint32_t,
+                                          std::uint64_t>>>;
+
+/// Pointer to the first value of a map (values are stored in index order, so
+/// a value's index is its offset from this)
+template <typename MapT> constexpr auto map_values_begin(MapT &map) {
+    if constexpr (requires { (*map.begin()).second; }) {
+        return std::addressof((*map.begin()).second);
+    } else {
+        return std::to_address(map.begin());
+    }
+}
+
+/// Bytes between a map's consecutive values: the entry size if keys & values
+/// are interleaved (hash_map_aos), 0 if the values are a plain array
+template <typename MapT>
+inline constexpr std::ptrdiff_t map_value_stride_v = []() {
+    using PlainMapT = std::remove_cvref_t<MapT>;
+    if constexpr (requires { typename PlainMapT::entry_type; }) {
+        return static_cast<std::ptrdiff_t>(
+            sizeof(typename PlainMapT::entry_type));
+    } else {
+        return std::ptrdiff_t{0};
+    }
+}();
+
+/// Index of one of map's values (e.g. map.find(key)), in iteration order
+template <typename MapT, typename ValueT>
+constexpr std::size_t map_value_index(MapT &map, ValueT *value) {
+    if constexpr (map_value_stride_v<MapT> == 0) {
+        return static_cast<std::size_t>(value - map_values_begin(map));
+    } else {
+        auto const *first = map_values_begin(map);
+        auto const bytes = reinterpret_cast<const char *>(value) -
+                           reinterpret_cast<const char *>(first);
+        return static_cast<std::size_t>(bytes / map_value_stride_v<MapT>);
+    }
+}
+
+/// Value of map at index (in iteration order)
+template <typename MapT>
+constexpr auto &map_value_at(MapT &map, std::size_t idx) {
+    auto *values = map_values_begin(map);
+    if constexpr (map_value_stride_v<MapT> == 0) {
+        return values[idx];
+    } else {
+        using ValueT = std::remove_pointer_t<decltype(values)>;
+        using ByteT =
+            std::conditional_t<std::is_const_v<ValueT>, const char, char>;
+        return *reinterpret_cast<ValueT *>(
+            reinterpret_cast<ByteT *>(values) +
+            static_cast<std::ptrdiff_t>(idx) * map_value_stride_v<MapT>);
+    }
+}
+
+/// Distance between the smallest & largest key (as underlying integers) of
+/// a range of keys or key/value pairs
+template <typename RangeT>
+constexpr std::uint64_t key_range(const RangeT &items) noexcept {
+    auto key_of = [](const auto &item) {
+        if constexpr (requires { item.second; }) {
+            return item.first;
+        } else {
+            return item;
+        }
+    };
+    using KeyT = decltype(key_of(*std::begin(items)));
+    using KeyUnderlyingT = underlying_type<KeyT>;
+    using KeyUnsignedT = std::make_unsigned_t<KeyUnderlyingT>;
+    if (std::begin(items) == std::end(items)) {
+        return 0;
+    }
+    auto min = static_cast<KeyUnderlyingT>(key_of(*std::begin(items)));
+    auto max = min;
+    for (const auto &item : items) {
+        auto key = static_cast<KeyUnderlyingT>(key_of(item));
+        min = std::min(min, key);
+        max = std::max(max, key);
+    }
+    return static_cast<KeyUnsignedT>(static_cast<KeyUnsignedT>(max) -
+                                     static_cast<KeyUnsignedT>(min));
+}
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "traits.hpp"
+
+/*
+ * Access frequency (weight) tables, as dumped by frequency_recorder: an array
+ * of {key, weight} pairs, with keys given as their underlying integers. Keys
+ * missing from the table weigh 0.
+ */
+
+namespace heurohash::detail {
+template <typename ItemT> constexpr auto item_key(const ItemT &item) noexcept {
+    if constexpr (requires { item.second; }) {
+        return item.first;
+    } else {
+        return item;
+    }
+}
+
+/// Weights ordered by key, for weight_of
+template <typename WeightsT>
+constexpr WeightsT sorted_weights(WeightsT weights) noexcept {
+    std::sort(weights.begin(), weights.end(),
+              [](const auto &a, const auto &b) {
+                  return std::cmp_less(a.first, b.first);
+              });
+    return weights;
+}
+
+template <typename KeyT, typename WeightsT>
+constexpr std::uint64_t weight_of(const KeyT &key,
+                                  const WeightsT &sorted) noexcept {
+    auto raw = static_cast<underlying_type<KeyT>>(key);
+    auto it = std::lower_bound(sorted.begin(), sorted.end(), raw,
+                               [](const auto &entry, const auto &value) {
+                                   return std::cmp_less(entry.first, value);
+                               });
+    if (it != sorted.end() && std::cmp_equal(it->first, raw)) {
+        return static_cast<std::uint64_t>(it->second);
+    }
+    return 0;
+}
+
+/// Items (keys or key/value pairs) ordered by descending weight, items of
+/// equal weight keep their order
+template <typename T, std::size_t S, typename WeightsT>
+constexpr std::array<T, S> order_by_weight(const std::array<T, S> &items,
+                                           const WeightsT &weights) noexcept {
+    auto const sorted = sorted_weights(weights);
+    std::array<std::pair<std::uint64_t, std::size_t>, S> order{};
+    for (std::size_t i = 0; i < S; ++i) {
+        order[i] = {weight_of(item_key(items[i]), sorted), i};
+    }
+    std::sort(order.begin(), order.end(), [](const auto &a, const auto &b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    std::array<T, S> ordered{};
+    for (std::size_t i = 0; i < S; ++i) {
+        ordered[i] = items[order[i].second];
+    }
+    return ordered;
+}
+
+/// Number of items with a non-zero weight, capped at Count
+template <std::size_t Count, typename T, std::size_t S, typename WeightsT>
+constexpr std::size_t hot_count(const std::array<T, S> &items,
+                                const WeightsT &weights) noexcept {
+    auto const sorted = sorted_weights(weights);
+    auto const weighted = std::count_if(
+        items.begin(), items.end(),
+        [&](const auto &item) { return weight_of(item_key(item), sorted); });
+    return std::min(Count, static_cast<std::size_t>(weighted));
+}
+
+/// Keys of the Count heaviest items, heaviest first
+template <std::size_t Count, typename T, std::size_t S, typename WeightsT>
+constexpr auto hottest_keys(const std::array<T, S> &items,
+                            const WeightsT &weights) noexcept {
+    auto const ordered = order_by_weight(items, weights);
+    std::array<decltype(item_key(items[0])), Count> keys{};
+    for (std::size_t i = 0; i < Count; ++i) {
+        keys[i] = item_key(ordered[i]);
+    }
+    return keys;
+}
+
+/// Builder returning Builder's items ordered by descending Weights weight
+template <typename Builder, typename Weights> struct weighted_builder {
+    constexpr auto operator()() const noexcept {
+        return order_by_weight(Builder{}(), Weights{}());
+    }
+};
+} // namespace heurohash::detail
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "detail/traits.hpp"
+
+/*
+ * Compile time generated dispatch over the keys of a constexpr map (linear,
+ * sparse linear, paged, ordered or hash map, or a keyset). The keys are
+ * expanded into a chain of equality comparisons against constants, which
+ * compilers lower like a switch (jump table, bit test or compare tree), so
+ * each key's handler is called directly & can be inlined - no lookup followed
+ * by a call through a loaded pointer. Keys must be integral (or enums).
+ */
+
+namespace heurohash {
+/* Combines several handlers into a single overload set, e.g. to handle some
+ * keys separately: overloaded{[](std::integral_constant<Msg, Msg::A>) {...},
+ * [](auto key) {...}} */
+template <typename... Ts> struct overloaded : Ts... {
+    using Ts::operator()...;
+};
+template <typename... Ts> overloaded(Ts...) -> overloaded<Ts...>;
+
+namespace detail {
+struct dispatch_noop {
+    constexpr void operator()() const noexcept {}
+};
+
+template <auto &Map>
+using dispatch_key_t = typename std::remove_cvref_t<decltype(Map)>::key_type;
+
+/// Keys of Map, as an array
+template <auto &Map> consteval auto dispatch_keys() {
+    using KeyT = dispatch_key_t<Map>;
+    using KeyValT = underlying_type<KeyT>;
+    static_assert(std::is_integral_v<KeyValT>,
+                  "Dispatch requires integral (or enum) keys");
+    std::array<KeyT, Map.size()> keys{};
+    if constexpr (requires { Map.keys(); }) {
+        /* Sparse & paged maps discard their keys, but rebuild them from their
+         * bitmap/directory */
+        auto const map_keys = Map.keys();
+        std::copy(map_keys.begin(), map_keys.end(), keys.begin());
+    } else if constexpr (requires { Map.get_key_offset(); }) {
+        /* Linear maps & spans discard their keys, probe them back from the
+         * first. That's a lookup per slot of the key range, so spans over
+         * wide ranges may run into the compiler's constexpr step limit
+         * (-fconstexpr-ops-limit/-fconstexpr-steps), dispatch over the map
+         * itself instead */
+        using UnsignedT = std::make_unsigned_t<KeyValT>;
+        size_t found = 0;
+        for (UnsignedT slot = 0; found < keys.size(); ++slot) {
+            auto key = static_cast<KeyT>(static_cast<KeyValT>(
+                static_cast<UnsignedT>(Map.get_key_offset()) + slot));
+            if (Map.contains(key)) {
+                keys[found++] = key;
+            }
+        }
+    } else {
+        std::transform(Map.begin(), Map.end(), keys.begin(),
+                       [](const auto &item) -> KeyT {
+                           if constexpr (requires { item.first; }) {
+                               return item.first;
+                           } else {
+                               return item;
+                           }
+                       });
+    }
+    return keys;
+}
+
+template <auto &Map>
+inline constexpr auto dispatch_keys_v = dispatch_keys<Map>();
+
+template <auto &Map, typename F, typename Miss, size_t... I>
+constexpr auto dispatch_impl(const dispatch_key_t<Map> &key, F &f, Miss &miss,
+                             std::index_sequence<I...>) {
+    using KeyT = dispatch_key_t<Map>;
+    constexpr auto &keys = dispatch_keys_v<Map>;
+    using ResultT = std::common_type_t<
+        std::invoke_result_t<F &, std::integral_constant<KeyT, keys[I]>>...,
+        std::invoke_result_t<Miss &>>;
+
+    if constexpr (std::is_void_v<ResultT>) {
+        if (!((key == keys[I] &&
+               (f(std::integral_constant<KeyT, keys[I]>{}), true)) ||
+              ...)) {
+            miss();
+        }
+    } else {
+        std::optional<ResultT> result;
+        ((key == keys[I] &&
+          (result.emplace(f(std::integral_constant<KeyT, keys[I]>{})), true)) ||
+         ...);
+        return result ? std::move(*result) : static_cast<ResultT>(miss());
+    }
+}
+} // namespace detail
+
+/* Calls f(std::integral_constant<key_type, K>{}) for Map's key K equal to key,
+ * miss() if there's none. Map must be constexpr (e.g. static constexpr) */
+template <auto &Map, typename F, typename Miss = detail::dispatch_noop>
+constexpr auto dispatch(const detail::dispatch_key_t<Map> &key, F &&f,
+                        Miss &&miss = Miss{}) {
+    return detail::dispatch_impl<Map>(
+        key, f, miss, std::make_index_sequence<Map.size()>{});
+}
+
+/* Calls f(value) with Map's value for key, miss() if key isn't in Map. The
+ * value of each key is a compile time constant (e.g. a function pointer, which
+ * is then called directly) */
+template <auto &Map, typename F, typename Miss = detail::dispatch_noop>
+constexpr auto visit(const detail::dispatch_key_t<Map> &key, F &&f,
+                     Miss &&miss = Miss{}) {
+    return dispatch<Map>(
+        key, [&](auto map_key) { return f(Map[map_key.value]); }, miss);
+}
+} // namespace heurohash
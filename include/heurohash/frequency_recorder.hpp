@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+
+#include "detail/traits.hpp"
+
+namespace heurohash {
+/* Counts key lookups at run-time (e.g. in a profiling build) & dumps them as
+ * a header, whose weights builder can be passed to the make_weighted_*
+ * functions of the next build. Not thread-safe, not meant for production */
+template <typename KeyT> class frequency_recorder {
+    using KeyUnderlyingT = detail::underlying_type<KeyT>;
+    static_assert(std::is_integral_v<KeyUnderlyingT>,
+                  "frequency_recorder requires integral (or enum) keys");
+    using DumpKeyT = std::conditional_t<std::is_signed_v<KeyUnderlyingT>,
+                                        std::int64_t, std::uint64_t>;
+
+    std::map<KeyUnderlyingT, std::uint64_t> counts;
+
+  public:
+    void record(const KeyT &key) { ++counts[static_cast<KeyUnderlyingT>(key)]; }
+
+    std::uint64_t count(const KeyT &key) const {
+        auto it = counts.find(static_cast<KeyUnderlyingT>(key));
+        return it == counts.end() ? 0 : it->second;
+    }
+
+    void clear() noexcept { counts.clear(); }
+
+    /* Writes a header defining `name` as the weights builder */
+    void dump(std::ostream &out, std::string_view name) const {
+        out << "#pragma once\n\n"
+               "#include <array>\n"
+               "#include <cstdint>\n"
+               "#include <utility>\n\n"
+               "/* Generated by heurohash::frequency_recorder */\n"
+               "inline constexpr auto "
+            << name << " = [] {\n"
+            << "    return std::array<std::pair<"
+            << (std::is_signed_v<KeyUnderlyingT> ? "std::int64_t"
+                                                 : "std::uint64_t")
+            << ", std::uint64_t>, " << counts.size() << ">{{\n";
+        for (const auto &[key, weight] : counts) {
+            out << "        {";
+            if constexpr (std::is_signed_v<DumpKeyT>) {
+                if (key == std::numeric_limits<DumpKeyT>::min()) {
+                    /* Not expressible as a single (negated) literal */
+                    out << "INT64_MIN";
+                } else {
+                    out << static_cast<DumpKeyT>(key);
+                }
+            } else {
+                /* Unsuffixed literals of 2^63 & up don't fit any signed type */
+                out << static_cast<DumpKeyT>(key) << 'u';
+            }
+            out << ", " << weight << "u},\n";
+        }
+        out << "    }};\n"
+               "};\n";
+    }
+};
+} // namespace heurohash
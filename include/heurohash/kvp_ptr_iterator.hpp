@@ -2,16 +2,39 @@
 
 #include "detail/traits.hpp"
 #include <iterator>
+#include <type_traits>
 
 namespace heurohash {
-template <typename KeyT, typename ValueT> class kvp_ptr_iterator {
-    const KeyT *key_ptr;
+/* KeyPtrT addresses the keys, a plain pointer unless the keyset stores them
+ * differently (e.g. detail::string_key_iterator) */
+template <typename KeyT, typename ValueT, typename KeyPtrT = const KeyT *>
+class kvp_ptr_iterator {
+    KeyPtrT key_ptr;
     ValueT *value_ptr;
+    /* Bytes between entries if keys & values are interleaved (AoS storage),
+     * 0 if they are separate arrays. Only the latter works at compile time */
+    std::ptrdiff_t stride;
+
+    template <typename T>
+    static constexpr T advance(T ptr, std::ptrdiff_t n,
+                               std::ptrdiff_t stride) noexcept {
+        if constexpr (std::is_pointer_v<T>) {
+            if (stride != 0) {
+                using PointeeT = std::remove_pointer_t<T>;
+                using ByteT = std::conditional_t<std::is_const_v<PointeeT>,
+                                                 const char, char>;
+                return reinterpret_cast<T>(reinterpret_cast<ByteT *>(ptr) +
+                                           n * stride);
+            }
+        }
+        return ptr + n;
+    }
 
   public:
     using iterator_category = std::random_access_iterator_tag;
     using difference_type = std::ptrdiff_t;
-    using value_type = std::pair<const KeyT &, ValueT &>;
+    using value_type =
+        std::pair<std::iter_reference_t<KeyPtrT>, ValueT &>;
     using reference = value_type;
 
     /* Inspiration for arrow proxy taken from:
@@ -22,11 +45,12 @@ template <typename KeyT, typename ValueT> class kvp_ptr_iterator {
     };
     using pointer = arrow_proxy;
 
-    constexpr kvp_ptr_iterator(const KeyT *key_ptr, ValueT *value_ptr) noexcept
-        : key_ptr(key_ptr), value_ptr(value_ptr) {}
+    constexpr kvp_ptr_iterator(KeyPtrT key_ptr, ValueT *value_ptr,
+                               std::ptrdiff_t stride = 0) noexcept
+        : key_ptr(key_ptr), value_ptr(value_ptr), stride(stride) {}
 
     constexpr kvp_ptr_iterator() noexcept
-        : key_ptr(nullptr), value_ptr(nullptr) {}
+        : key_ptr{}, value_ptr(nullptr), stride(0) {}
 
     constexpr kvp_ptr_iterator(const kvp_ptr_iterator &other) noexcept =
         default;
@@ -37,15 +61,13 @@ template <typename KeyT, typename ValueT> class kvp_ptr_iterator {
     constexpr kvp_ptr_iterator &
     operator=(kvp_ptr_iterator &&other) noexcept = default;
 
-    constexpr operator kvp_ptr_iterator<KeyT, const ValueT>() const noexcept {
-        return kvp_ptr_iterator<KeyT, const ValueT>{key_ptr, value_ptr};
+    constexpr operator kvp_ptr_iterator<KeyT, const ValueT, KeyPtrT>()
+        const noexcept {
+        return kvp_ptr_iterator<KeyT, const ValueT, KeyPtrT>{key_ptr, value_ptr,
+                                                             stride};
     }
 
-    constexpr kvp_ptr_iterator &operator++() noexcept {
-        ++key_ptr;
-        ++value_ptr;
-        return *this;
-    }
+    constexpr kvp_ptr_iterator &operator++() noexcept { return *this += 1; }
 
     constexpr kvp_ptr_iterator operator++(int) noexcept {
         kvp_ptr_iterator tmp = *this;
@@ -53,11 +75,7 @@ template <typename KeyT, typename ValueT> class kvp_ptr_iterator {
         return tmp;
     }
 
-    constexpr kvp_ptr_iterator &operator--() noexcept {
-        --key_ptr;
-        --value_ptr;
-        return *this;
-    }
+    constexpr kvp_ptr_iterator &operator--() noexcept { return *this -= 1; }
 
     constexpr kvp_ptr_iterator operator--(int) noexcept {
         kvp_ptr_iterator tmp = *this;
@@ -66,43 +84,54 @@ template <typename KeyT, typename ValueT> class kvp_ptr_iterator {
     }
 
     constexpr kvp_ptr_iterator &operator+=(difference_type n) noexcept {
-        key_ptr += n;
-        value_ptr += n;
+        key_ptr = advance(key_ptr, n, stride);
+        value_ptr = advance(value_ptr, n, stride);
         return *this;
     }
 
     constexpr kvp_ptr_iterator &operator-=(difference_type n) noexcept {
-        key_ptr -= n;
-        value_ptr -= n;
-        return *this;
+        return *this += -n;
     }
 
     constexpr kvp_ptr_iterator operator+(difference_type n) noexcept {
-        return kvp_ptr_iterator(key_ptr + n, value_ptr + n);
+        return kvp_ptr_iterator(advance(key_ptr, n, stride),
+                                advance(value_ptr, n, stride), stride);
     }
 
     friend constexpr kvp_ptr_iterator
     operator+(difference_type n, const kvp_ptr_iterator &it) noexcept {
-        return kvp_ptr_iterator(it.key_ptr + n, it.value_ptr + n);
+        return kvp_ptr_iterator(advance(it.key_ptr, n, it.stride),
+                                advance(it.value_ptr, n, it.stride), it.stride);
     }
 
-    constexpr kvp_ptr_iterator<KeyT, std::remove_const_t<ValueT>>
+    constexpr kvp_ptr_iterator<KeyT, std::remove_const_t<ValueT>, KeyPtrT>
     operator+(difference_type n) const noexcept {
-        return kvp_ptr_iterator<KeyT, std::remove_const_t<ValueT>>(
-            key_ptr + n, value_ptr + n);
+        return kvp_ptr_iterator<KeyT, std::remove_const_t<ValueT>, KeyPtrT>(
+            advance(key_ptr, n, stride), advance(value_ptr, n, stride),
+            stride);
     }
 
     constexpr kvp_ptr_iterator operator-(difference_type n) const noexcept {
-        return kvp_ptr_iterator(key_ptr - n, value_ptr - n);
+        return kvp_ptr_iterator(advance(key_ptr, -n, stride),
+                                advance(value_ptr, -n, stride), stride);
     }
 
     friend constexpr kvp_ptr_iterator
     operator-(difference_type n, const kvp_ptr_iterator &it) noexcept {
-        return kvp_ptr_iterator(it.key_ptr - n, it.value_ptr - n);
+        return kvp_ptr_iterator(advance(it.key_ptr, -n, it.stride),
+                                advance(it.value_ptr, -n, it.stride),
+                                it.stride);
     }
 
     constexpr difference_type
     operator-(const kvp_ptr_iterator &other) const noexcept {
+        if constexpr (std::is_pointer_v<KeyPtrT>) {
+            if (stride != 0) {
+                return (reinterpret_cast<const char *>(key_ptr) -
+                        reinterpret_cast<const char *>(other.key_ptr)) /
+                       stride;
+            }
+        }
         return key_ptr - other.key_ptr;
     }
 
@@ -133,7 +162,7 @@ template <typename KeyT, typename ValueT> class kvp_ptr_iterator {
     }
 
     constexpr reference operator[](difference_type n) const noexcept {
-        return {*(key_ptr + n), *(value_ptr + n)};
+        return {*advance(key_ptr, n, stride), *advance(value_ptr, n, stride)};
     }
 };
 }; // namespace heurohash
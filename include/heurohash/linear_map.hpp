@@ -1,11 +1,17 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
 #include <numeric>
 #include <span>
 
+#include "detail/comp_time_arg.hpp"
 #include "detail/traits.hpp"
 
+#include "atomic_value.hpp"
+
 namespace heurohash {
 namespace detail {
 template <typename T>
@@ -18,11 +24,44 @@ static constexpr size_t linear_find_impl(const T &key, size_t size,
 
     return key - offset_from_zero;
 }
+
+/* Index of key among the occupied slots of a sparse_linear_map (size if it's
+ * a hole or out of range). occupancy_rank[i] counts the occupied slots before
+ * word i, so that's one bitmap word & a popcount. rank_base is the index of
+ * the first value a (sub)span covers */
+template <typename T>
+static constexpr size_t
+sparse_linear_find_impl(const T &key, T offset_from_zero,
+                        const std::uint64_t *occupancy,
+                        const std::uint32_t *occupancy_rank, size_t slots,
+                        size_t rank_base, size_t size) noexcept {
+    using UnsignedT = std::make_unsigned_t<T>;
+    if (key < offset_from_zero) {
+        return size;
+    }
+    auto slot = static_cast<size_t>(
+        static_cast<UnsignedT>(static_cast<UnsignedT>(key) -
+                               static_cast<UnsignedT>(offset_from_zero)));
+    if (slot >= slots) {
+        return size;
+    }
+    auto word = occupancy[slot / 64];
+    auto bit = std::uint64_t{1} << (slot % 64);
+    if ((word & bit) == 0) {
+        return size;
+    }
+    auto idx = occupancy_rank[slot / 64] +
+               static_cast<size_t>(std::popcount(word & (bit - 1))) - rank_base;
+    return idx < size ? idx : size;
+}
 }; // namespace detail
 
-/* FWD declare linear_map for span friend */
+/* FWD declare linear_map & sparse_linear_map for span friend */
 template <typename KeyT, typename ValueT, size_t Size> class linear_map;
 
+template <typename KeyT, typename ValueT, size_t Size, size_t Slots>
+class sparse_linear_map;
+
 /* Span of linear map (aka desized, to allow better 'anonymous' interfaces) */
 template <typename KeyT, typename ValueT> class linear_map_span {
     using KeyValT = detail::underlying_type<KeyT>;
@@ -30,6 +69,11 @@ template <typename KeyT, typename ValueT> class linear_map_span {
 
     StorageT data;
     KeyValT offset_from_zero;
+    /* Occupancy bitmap & ranks of a sparse_linear_map (nullptr if dense) */
+    const std::uint64_t *occupancy{nullptr};
+    const std::uint32_t *occupancy_rank{nullptr};
+    size_t slots{0};
+    size_t rank_base{0};
 
   public:
     /* Member types */
@@ -48,10 +92,22 @@ template <typename KeyT, typename ValueT> class linear_map_span {
     template <typename Key, typename Value, size_t Size>
     friend class linear_map;
 
+    template <typename Key, typename Value, size_t Size, size_t Slots>
+    friend class sparse_linear_map;
+
     explicit constexpr linear_map_span(std::span<ValueT> _data,
                                        KeyValT offset) noexcept
         : data(_data), offset_from_zero(offset) {}
 
+    explicit constexpr linear_map_span(std::span<ValueT> _data, KeyValT offset,
+                                       const std::uint64_t *_occupancy,
+                                       const std::uint32_t *_occupancy_rank,
+                                       size_t _slots,
+                                       size_t _rank_base = 0) noexcept
+        : data(_data), offset_from_zero(offset), occupancy(_occupancy),
+          occupancy_rank(_occupancy_rank), slots(_slots),
+          rank_base(_rank_base) {}
+
   public:
     constexpr linear_map_span(const linear_map_span &) noexcept = default;
     constexpr linear_map_span(linear_map_span &&) noexcept = default;
@@ -75,11 +131,11 @@ template <typename KeyT, typename ValueT> class linear_map_span {
     }
 
     constexpr size_type count(const KeyT &key) const noexcept {
-        return contains() ? 1 : 0;
+        return contains(key) ? 1 : 0;
     }
 
     constexpr bool contains(const KeyT &key) const noexcept {
-        return find_impl(key) != end();
+        return find_impl(key) != data.size();
     }
 
     constexpr bool empty() const noexcept { return data.empty(); }
@@ -103,11 +159,28 @@ template <typename KeyT, typename ValueT> class linear_map_span {
     constexpr linear_map_span<KeyT, ValueT>
     subspan(size_t offset,
             size_t count = std::numeric_limits<size_t>::max()) const noexcept {
-        return linear_map_span{data.subspan(offset, count), offset};
+        if (occupancy != nullptr) {
+            /* Values are rank-compacted, so the subspan keeps the bitmap &
+             * only skips the first offset ranks */
+            return linear_map_span{data.subspan(offset, count),
+                                   offset_from_zero,
+                                   occupancy,
+                                   occupancy_rank,
+                                   slots,
+                                   rank_base + offset};
+        }
+        return linear_map_span{
+            data.subspan(offset, count),
+            static_cast<KeyValT>(offset_from_zero + offset)};
     }
 
   private:
     constexpr size_t find_impl(const KeyT &key) const noexcept {
+        if (occupancy != nullptr) {
+            return detail::sparse_linear_find_impl<KeyValT>(
+                static_cast<KeyValT>(key), offset_from_zero, occupancy,
+                occupancy_rank, slots, rank_base, data.size());
+        }
         return detail::linear_find_impl<KeyValT>(static_cast<KeyValT>(key),
                                                  data.size(), offset_from_zero);
     }
@@ -205,11 +278,11 @@ template <typename KeyT, typename ValueT, size_t Size> class linear_map {
     }
 
     constexpr size_type count(const KeyT &key) const noexcept {
-        return contains() ? 1 : 0;
+        return contains(key) ? 1 : 0;
     }
 
     constexpr bool contains(const KeyT &key) const noexcept {
-        return find_impl(key) != end();
+        return find_impl(key) != data.size();
     }
 
     /* Capacity */
@@ -294,4 +367,304 @@ static consteval auto
 make_linear_map(std::array<std::pair<T, U>, N> const &items) {
     return linear_map<T, U, N>{items};
 }
+
+/* linear_map with atomically accessed values (see atomic_value) */
+template <typename KeyT, typename ValueT, size_t Size>
+using atomic_linear_map = linear_map<KeyT, atomic_value<ValueT>, Size>;
+
+template <typename KeyT, typename ValueT>
+using atomic_linear_map_span = linear_map_span<KeyT, atomic_value<ValueT>>;
+
+template <typename T, typename U, std::size_t N>
+static consteval auto
+make_atomic_linear_map(std::pair<T, U> const (&items)[N]) {
+    return atomic_linear_map<T, U, N>{std::begin(items), std::end(items)};
+}
+
+template <typename T, typename U, std::size_t N>
+static consteval auto
+make_atomic_linear_map(std::array<std::pair<T, U>, N> const &items) {
+    return atomic_linear_map<T, U, N>{items.begin(), items.end()};
+}
+
+/* Whether a sparse_linear_map beats storing the keys (e.g. ordered_map), for
+ * size keys spanning distance + 1 slots: its occupancy bitmap & ranks (12
+ * bytes per 64 slots) must not outweigh the keys themselves */
+template <typename KeyT>
+constexpr bool sparse_linear_preferred(size_t size,
+                                       std::uint64_t distance) noexcept {
+    return std::is_integral_v<detail::underlying_type<KeyT>> && size > 0 &&
+           size < UINT32_MAX && (distance / 64 + 1) * 12 <= size * sizeof(KeyT);
+}
+
+/* linear_map for keys with holes: keys span Slots slots (back - front <
+ * Slots), an occupancy bitmap marks which of them are keys. Values are stored
+ * rank-compacted (in key order), so find/contains are a bitmap word test &
+ * popcount, with no key comparisons. Keys are discarded, as with linear_map */
+template <typename KeyT, typename ValueT, size_t Size, size_t Slots>
+class sparse_linear_map {
+    using KeyValT = detail::underlying_type<KeyT>;
+    using StorageT = std::array<ValueT, Size>;
+    static_assert(std::is_integral_v<KeyValT>,
+                  "Type must be integral (suitable for indexing array)");
+    static_assert(Size < UINT32_MAX, "Too many keys for occupancy ranks");
+    static constexpr size_t Words = (Slots + 63) / 64;
+
+    StorageT data{};
+    std::array<std::uint64_t, Words> occupancy{};
+    std::array<std::uint32_t, Words> occupancy_rank{};
+    /* Key of slot 0 */
+    KeyValT offset_from_zero{};
+
+  public:
+    /* Member types */
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = mapped_type;
+    using pair_type = std::pair<key_type, value_type>;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+    using pointer = value_type *;
+    using const_pointer = const value_type *;
+    using iterator = typename StorageT::iterator;
+    using const_iterator = typename StorageT::const_iterator;
+
+    template <typename InputIt>
+    consteval sparse_linear_map(InputIt first, InputIt last) noexcept
+        : offset_from_zero(check_prereqs(first, last)) {
+        std::for_each(first, last, [this](const auto &item) {
+            auto slot = slot_of(key_of(item));
+            occupancy[slot / 64] |= std::uint64_t{1} << (slot % 64);
+        });
+        std::uint32_t rank = 0;
+        for (size_t i = 0; i < Words; ++i) {
+            occupancy_rank[i] = rank;
+            rank += static_cast<std::uint32_t>(std::popcount(occupancy[i]));
+        }
+        /* Copy over data if iterator is KVP */
+        if constexpr (requires { (*first).second; }) {
+            std::for_each(first, last, [this](const auto &kvp) {
+                data[find_impl(kvp.first)] = kvp.second;
+            });
+        }
+    }
+
+    consteval sparse_linear_map(
+        std::initializer_list<pair_type> kvp_items) noexcept
+        : sparse_linear_map(kvp_items.begin(), kvp_items.end()) {}
+    consteval sparse_linear_map(
+        std::initializer_list<key_type> key_items) noexcept
+        : sparse_linear_map(key_items.begin(), key_items.end()) {}
+
+    consteval sparse_linear_map(
+        const std::array<pair_type, Size> &kvp_items) noexcept
+        : sparse_linear_map(kvp_items.begin(), kvp_items.end()) {}
+    consteval sparse_linear_map(
+        const std::array<key_type, Size> &key_items) noexcept
+        : sparse_linear_map(key_items.begin(), key_items.end()) {}
+
+    consteval sparse_linear_map(const pair_type (&kvp_items)[Size]) noexcept
+        : sparse_linear_map(std::begin(kvp_items), std::end(kvp_items)) {}
+    consteval sparse_linear_map(const key_type (&key_items)[Size]) noexcept
+        : sparse_linear_map(std::begin(key_items), std::end(key_items)) {}
+
+    /* Copying can take place at run-time*/
+    constexpr sparse_linear_map(const sparse_linear_map &) noexcept = default;
+    constexpr sparse_linear_map &
+    operator=(const sparse_linear_map &) noexcept = default;
+
+    /* Moving can take place at run-time*/
+    constexpr sparse_linear_map(sparse_linear_map &&) noexcept = default;
+    constexpr sparse_linear_map &
+    operator=(sparse_linear_map &&) noexcept = default;
+
+    /* Lookup */
+    constexpr iterator find(const KeyT &key) noexcept {
+        return data.begin() + find_impl(key);
+    }
+
+    constexpr const_iterator find(const KeyT &key) const noexcept {
+        return data.begin() + find_impl(key);
+    }
+
+    constexpr ValueT &operator[](const KeyT &key) noexcept {
+        return data[find_impl(key)];
+    }
+
+    constexpr ValueT const &operator[](const KeyT &key) const noexcept {
+        return data[find_impl(key)];
+    }
+
+    constexpr ValueT const &at(const KeyT &key) const noexcept {
+        auto idx = find_impl(key);
+        constexpr_assert(idx != Size, "Key not found");
+        return data[idx];
+    }
+
+    constexpr ValueT &at(const KeyT &key) noexcept {
+        auto idx = find_impl(key);
+        constexpr_assert(idx != Size, "Key not found");
+        return data[idx];
+    }
+
+    constexpr size_type count(const KeyT &key) const noexcept {
+        return contains(key) ? 1 : 0;
+    }
+
+    constexpr bool contains(const KeyT &key) const noexcept {
+        return find_impl(key) != Size;
+    }
+
+    /* Capacity */
+    constexpr bool empty() const noexcept { return Size == 0; }
+
+    constexpr size_t size() const noexcept { return Size; }
+
+    constexpr size_t max_size() const noexcept { return Size; }
+
+    /* Iterators (values in key order) */
+    constexpr iterator begin() noexcept { return data.begin(); }
+
+    constexpr const_iterator begin() const noexcept { return data.cbegin(); }
+
+    constexpr iterator end() noexcept { return data.end(); }
+
+    constexpr const_iterator end() const noexcept { return data.cend(); }
+
+    constexpr const_iterator cbegin() const noexcept { return data.cbegin(); }
+
+    constexpr const_iterator cend() const noexcept { return data.cend(); }
+
+    constexpr void clear() noexcept { data.fill(ValueT{}); }
+
+    constexpr KeyValT get_key_offset() const noexcept {
+        return offset_from_zero;
+    }
+
+    /* Keys (in value order), rebuilt from the occupancy bitmap */
+    constexpr std::array<KeyT, Size> keys() const noexcept {
+        std::array<KeyT, Size> result{};
+        size_t found = 0;
+        for (size_t i = 0; i < Words; ++i) {
+            for (auto word = occupancy[i]; word != 0; word &= word - 1) {
+                result[found++] = key_at_slot(
+                    i * 64 + static_cast<size_t>(std::countr_zero(word)));
+            }
+        }
+        return result;
+    }
+
+    constexpr operator linear_map_span<KeyT, ValueT>() noexcept {
+        return to_span();
+    }
+
+    constexpr operator linear_map_span<KeyT, const ValueT>() const noexcept {
+        return to_span();
+    }
+
+    constexpr linear_map_span<KeyT, ValueT> to_span() noexcept {
+        return linear_map_span<KeyT, ValueT>(data, offset_from_zero,
+                                             occupancy.data(),
+                                             occupancy_rank.data(), Slots);
+    }
+
+    constexpr linear_map_span<KeyT, const ValueT> to_span() const noexcept {
+        return linear_map_span<KeyT, const ValueT>(
+            data, offset_from_zero, occupancy.data(), occupancy_rank.data(),
+            Slots);
+    }
+
+  private:
+    template <typename ItemT>
+    static constexpr KeyValT key_of(const ItemT &item) noexcept {
+        if constexpr (requires { item.second; }) {
+            return static_cast<KeyValT>(item.first);
+        } else {
+            return static_cast<KeyValT>(item);
+        }
+    }
+
+    constexpr size_t slot_of(KeyValT key) const noexcept {
+        using UnsignedT = std::make_unsigned_t<KeyValT>;
+        return static_cast<size_t>(static_cast<UnsignedT>(
+            static_cast<UnsignedT>(key) -
+            static_cast<UnsignedT>(offset_from_zero)));
+    }
+
+    constexpr KeyT key_at_slot(size_t slot) const noexcept {
+        using UnsignedT = std::make_unsigned_t<KeyValT>;
+        return static_cast<KeyT>(static_cast<KeyValT>(static_cast<UnsignedT>(
+            static_cast<UnsignedT>(offset_from_zero) + slot)));
+    }
+
+    template <typename InputIt>
+    static constexpr auto check_prereqs(InputIt begin, InputIt end) {
+        constexpr_assert(std::distance(begin, end) == Size, "Invalid size");
+        std::array<KeyValT, Size> prereq_arr{};
+        std::transform(begin, end, prereq_arr.begin(),
+                       [](const auto &item) { return key_of(item); });
+        std::sort(prereq_arr.begin(), prereq_arr.end());
+
+        auto adjacent_val =
+            std::adjacent_find(prereq_arr.cbegin(), prereq_arr.cend());
+        constexpr_assert(adjacent_val == prereq_arr.cend(),
+                         "Duplicate entries in keys");
+        if constexpr (Size != 0) {
+            constexpr_assert(detail::key_range(prereq_arr) < Slots,
+                             "Keys must fit into Slots slots");
+            return prereq_arr.front();
+        }
+        return KeyValT{};
+    }
+
+    constexpr size_t find_impl(const KeyT &key) const noexcept {
+        return detail::sparse_linear_find_impl<KeyValT>(
+            static_cast<KeyValT>(key), offset_from_zero, occupancy.data(),
+            occupancy_rank.data(), Slots, 0, Size);
+    }
+};
+
+/* Sparse map sized to the key range of the builder's (compile time) items */
+static consteval auto make_sparse_linear_map(comp_time auto builder) {
+    constexpr auto items = builder();
+    using PairT = std::remove_cvref_t<decltype(*std::begin(items))>;
+    return sparse_linear_map<typename PairT::first_type,
+                             typename PairT::second_type, std::size(items),
+                             detail::key_range(items) + 1>{items};
+}
+
+/* Holes, keys outside the slots & negative keys are all misses */
+static constexpr auto sparse_lm = make_sparse_linear_map([] {
+    return std::array{std::pair{-70, 0}, std::pair{-3, 1}, std::pair{0, 2},
+                      std::pair{64, 3}, std::pair{200, 4}};
+});
+static_assert(std::is_same_v<decltype(sparse_lm),
+                             const sparse_linear_map<int, int, 5, 271>>);
+static_assert(sparse_lm.at(-70) == 0);
+static_assert(sparse_lm.at(-3) == 1);
+static_assert(sparse_lm.at(0) == 2);
+static_assert(sparse_lm.at(64) == 3);
+static_assert(sparse_lm.at(200) == 4);
+static_assert(!sparse_lm.contains(-69));
+static_assert(!sparse_lm.contains(63));
+static_assert(!sparse_lm.contains(-71));
+static_assert(!sparse_lm.contains(201));
+static_assert(!sparse_lm.contains(-1000));
+static_assert(!sparse_lm.contains(1000));
+static_assert(sparse_lm.find(1) == sparse_lm.end());
+
+/* Sparse subspans start at a rank (rank_base), keys ranked before it or
+ * past its end are misses */
+static constexpr auto sparse_sub = sparse_lm.to_span().subspan(2, 2);
+static_assert(sparse_sub.size() == 2);
+static_assert(sparse_sub.at(0) == 2);
+static_assert(sparse_sub.at(64) == 3);
+static_assert(!sparse_sub.contains(-3));
+static_assert(!sparse_sub.contains(200));
+static_assert(!sparse_sub.contains(1));
+static_assert(sparse_sub.subspan(1).at(64) == 3);
+static_assert(!sparse_sub.subspan(1).contains(0));
+static_assert(sparse_lm.to_span().subspan(3).at(200) == 4);
 }; // namespace heurohash
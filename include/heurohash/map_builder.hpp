@@ -1,15 +1,112 @@
 #pragma once
 
+#include "linear_map.hpp"
 #include "ordered_map.hpp"
 #include "pmh_map.hpp"
 
 namespace heurohash {
+namespace detail {
+enum class mixed_map_kind { linear, sparse_linear, hash, ordered };
+
+template <typename KeyT, size_t Size>
+consteval mixed_map_kind mixed_map_kind_of(const auto &data) {
+    if constexpr (std::is_integral_v<underlying_type<KeyT>> && Size > 0) {
+        /* Keys are (close to) a dense range: index directly */
+        auto distance = key_range(data);
+        if (distance == Size - 1) {
+            return mixed_map_kind::linear;
+        }
+        if (sparse_linear_preferred<KeyT>(Size, distance)) {
+            return mixed_map_kind::sparse_linear;
+        }
+    }
+    /* Tiny integral keysets: a vector scan (ordered_map's default search)
+     * beats the LUT probe */
+    if (!linear_scan_search::preferred<KeyT, Size> && Size <= 16) {
+        return mixed_map_kind::hash;
+    }
+    return mixed_map_kind::ordered;
+}
+} // namespace detail
+
+/* Map kind picked for the builder's keys (see mixed_map_kind_of). Tiny
+ * integral keysets get an ordered_map only if the target's vectors can scan
+ * them (linear_scan_search), a hash map otherwise, so TUs built with
+ * different -m options (or HEUROHASH_DISABLE_SIMD_PROBE) get different types
+ * for the same builder. Don't pass the result between such TUs by type */
 static constexpr auto gen_mixed_map(comp_time auto builder) {
     constexpr auto data = builder();
-    if constexpr (std::size(data) <= 16) {
+    using KeyT = std::remove_cvref_t<decltype(std::begin(data)->first)>;
+    constexpr auto kind =
+        detail::mixed_map_kind_of<KeyT, std::size(data)>(data);
+    if constexpr (kind == detail::mixed_map_kind::linear) {
+        return heurohash::make_linear_map(data);
+    } else if constexpr (kind == detail::mixed_map_kind::sparse_linear) {
+        return heurohash::make_sparse_linear_map(builder);
+    } else if constexpr (kind == detail::mixed_map_kind::hash) {
         return heurohash::make_hash_map(builder);
     } else {
         return heurohash::make_ordered_map(data);
     }
 }
+
+/* Contiguous keys: linear_map */
+static constexpr auto mixed_linear = gen_mixed_map([] {
+    return std::array{std::pair{12, 2}, std::pair{10, 0}, std::pair{11, 1}};
+});
+static_assert(
+    std::is_same_v<decltype(mixed_linear), const linear_map<int, int, 3>>);
+static_assert(mixed_linear.at(11) == 1);
+static_assert(!mixed_linear.contains(13));
+
+/* Holes, but a bitmap word is no larger than the keys: sparse_linear_map */
+static constexpr auto mixed_sparse = gen_mixed_map([] {
+    return std::array{std::pair{9, 2}, std::pair{0, 0}, std::pair{5, 1}};
+});
+static_assert(std::is_same_v<decltype(mixed_sparse),
+                             const sparse_linear_map<int, int, 3, 10>>);
+static_assert(mixed_sparse.at(5) == 1);
+static_assert(!mixed_sparse.contains(4));
+
+/* Too few wide spread keys for a vector scan: hash map */
+static constexpr auto mixed_hash_keys = std::array{
+    std::pair{50000, 2}, std::pair{1, 0}, std::pair{1000, 1}};
+static_assert(detail::mixed_map_kind_of<int, 3>(mixed_hash_keys) ==
+              detail::mixed_map_kind::hash);
+static constexpr auto mixed_hash =
+    gen_mixed_map([] { return mixed_hash_keys; });
+static_assert(mixed_hash.at(1000) == 1);
+static_assert(mixed_hash.at(50000) == 2);
+static_assert(!mixed_hash.contains(2));
+
+/* Wide spread keys filling a vector: ordered_map (scanned), if the target
+ * has vectors for the scan. Otherwise still a hash map */
+static constexpr auto mixed_ordered_keys = [] {
+    std::array<std::pair<int, int>, 8> kvps{};
+    for (int i = 0; i < 8; ++i) {
+        kvps[i] = {1000 * i, i};
+    }
+    return kvps;
+}();
+static_assert(detail::mixed_map_kind_of<int, 8>(mixed_ordered_keys) ==
+              (linear_scan_search::preferred<int, 8>
+                   ? detail::mixed_map_kind::ordered
+                   : detail::mixed_map_kind::hash));
+static constexpr auto mixed_ordered =
+    gen_mixed_map([] { return mixed_ordered_keys; });
+static_assert(mixed_ordered.at(3000) == 3);
+static_assert(!mixed_ordered.contains(3001));
+
+/* More keys than a hash map is picked for: ordered_map on any target */
+static constexpr auto mixed_large = gen_mixed_map([] {
+    std::array<std::pair<int, int>, 20> kvps{};
+    for (int i = 0; i < 20; ++i) {
+        kvps[i] = {1000 * i, i};
+    }
+    return kvps;
+});
+static_assert(
+    std::is_same_v<decltype(mixed_large), const ordered_map<int, int, 20>>);
+static_assert(mixed_large.at(19000) == 19);
+static_assert(!mixed_large.contains(19001));
 } // namespace heurohash
@@ -2,8 +2,10 @@
 
 #include <algorithm>
 #include <functional>
+#include <span>
 #include <utility>
 
+#include "detail/comp_time_arg.hpp"
 #include "detail/traits.hpp"
 
 #include "kvp_ptr_iterator.hpp"
@@ -13,14 +15,16 @@
 namespace heurohash {
 
 template <typename KeyT, typename ValueT, size_t Size,
-          typename Compare = std::less<KeyT>>
+          typename Compare = std::less<KeyT>, typename Search = auto_search>
 class ordered_map {
     using StorageT = std::array<ValueT, Size>;
-    ordered_map_keyset<KeyT, Size, Compare> keyset;
+    using KeysetT = ordered_map_keyset<KeyT, Size, Compare, Search>;
+    using KeyPtrT = typename KeysetT::const_iterator;
+    KeysetT keyset;
     StorageT values{};
 
   public:
-    using key_type = typename decltype(keyset)::key_type;
+    using key_type = typename KeysetT::key_type;
     using mapped_type = ValueT;
     using value_type = ValueT;
     using pair_type = std::pair<key_type, value_type>;
@@ -30,8 +34,8 @@ class ordered_map {
     using const_reference = const value_type &;
     using pointer = value_type *;
     using const_pointer = const value_type *;
-    using iterator = kvp_ptr_iterator<KeyT, ValueT>;
-    using const_iterator = kvp_ptr_iterator<KeyT, const ValueT>;
+    using iterator = kvp_ptr_iterator<KeyT, ValueT, KeyPtrT>;
+    using const_iterator = kvp_ptr_iterator<KeyT, const ValueT, KeyPtrT>;
 
     template <typename InputIt>
     static constexpr std::array<KeyT, Size> extract_keys(InputIt first,
@@ -94,6 +98,23 @@ class ordered_map {
         return values.cbegin() + keyset.find(key);
     }
 
+    /* Batched find, out[i] = find(in[i]) (i.e. end() if not found) */
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<ValueT *> out) noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        keyset.find_many_impl(in, [&](size_t i, size_t idx) {
+            out[i] = values.begin() + idx;
+        });
+    }
+
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<const ValueT *> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        keyset.find_many_impl(in, [&](size_t i, size_t idx) {
+            out[i] = values.cbegin() + idx;
+        });
+    }
+
     constexpr ValueT &operator[](const KeyT &key) noexcept {
         return values[keyset.find(key)];
     }
@@ -115,7 +136,7 @@ class ordered_map {
     }
 
     constexpr size_type count(const key_type &key) const noexcept {
-        return contains() ? 1 : 0;
+        return contains(key) ? 1 : 0;
     }
 
     constexpr bool contains(const key_type &key) const noexcept {
@@ -146,17 +167,61 @@ class ordered_map {
         return const_iterator{keyset.end(), values.cend()};
     }
 
-    constexpr void clear() noexcept { values.fill(ValueT{}); }
+    /* Range lookups, return subspans (see ordered_map_span) */
+    constexpr auto lower_bound(const KeyT &key) noexcept {
+        return to_span().lower_bound(key);
+    }
 
-    constexpr operator ordered_map_span<KeyT, ValueT, Compare>() noexcept {
-        return ordered_map_span<KeyT, ValueT, Compare>(
-            keyset.begin(), values.data(), Size, keyset.key_comp());
+    constexpr auto lower_bound(const KeyT &key) const noexcept {
+        return to_span().lower_bound(key);
     }
 
+    constexpr auto upper_bound(const KeyT &key) noexcept {
+        return to_span().upper_bound(key);
+    }
+
+    constexpr auto upper_bound(const KeyT &key) const noexcept {
+        return to_span().upper_bound(key);
+    }
+
+    constexpr auto equal_range(const KeyT &key) noexcept {
+        return to_span().equal_range(key);
+    }
+
+    constexpr auto equal_range(const KeyT &key) const noexcept {
+        return to_span().equal_range(key);
+    }
+
+    constexpr auto range(const KeyT &lo, const KeyT &hi) noexcept {
+        return to_span().range(lo, hi);
+    }
+
+    constexpr auto range(const KeyT &lo, const KeyT &hi) const noexcept {
+        return to_span().range(lo, hi);
+    }
+
+    constexpr void clear() noexcept { values.fill(ValueT{}); }
+
     constexpr
-    operator ordered_map_span<KeyT, const ValueT, Compare>() const noexcept {
-        return ordered_map_span<KeyT, const ValueT, Compare>(
-            keyset.begin(), values.data(), Size, keyset.key_comp());
+    operator ordered_map_span<KeyT, ValueT, Compare, KeyPtrT>() noexcept {
+        return to_span();
+    }
+
+    constexpr operator ordered_map_span<KeyT, const ValueT, Compare, KeyPtrT>()
+        const noexcept {
+        return to_span();
+    }
+
+    constexpr auto to_span() noexcept {
+        return ordered_map_span<KeyT, ValueT, Compare, KeyPtrT>(
+            keyset.begin(), values.data(), Size, keyset.key_comp(), &keyset,
+            keyset.search_fn());
+    }
+
+    constexpr auto to_span() const noexcept {
+        return ordered_map_span<KeyT, const ValueT, Compare, KeyPtrT>(
+            keyset.begin(), values.data(), Size, keyset.key_comp(), &keyset,
+            keyset.search_fn());
     }
 };
 
@@ -184,4 +249,76 @@ make_ordered_map(std::array<std::pair<T, U>, N> const &items,
     return ordered_map<T, U, N, Compare>{items, compare};
 }
 
+/* ordered_map with atomically accessed values (see atomic_value) */
+template <typename KeyT, typename ValueT, size_t Size,
+          typename Compare = std::less<KeyT>, typename Search = auto_search>
+using atomic_ordered_map =
+    ordered_map<KeyT, atomic_value<ValueT>, Size, Compare, Search>;
+
+template <typename T, typename U, std::size_t N>
+static consteval auto
+make_atomic_ordered_map(std::pair<T, U> const (&items)[N]) {
+    return atomic_ordered_map<T, U, N>{std::begin(items), std::end(items)};
+}
+
+template <typename T, typename U, std::size_t N>
+static consteval auto
+make_atomic_ordered_map(std::array<std::pair<T, U>, N> const &items) {
+    return atomic_ordered_map<T, U, N>{items.begin(), items.end()};
+}
+
+/* Map with a packed keyset (see make_packed_ordered_keyset) */
+static consteval auto make_packed_ordered_map(comp_time auto builder) {
+    constexpr auto items = builder();
+    using PairT = std::remove_cvref_t<decltype(*std::begin(items))>;
+    using SearchT = frame_of_reference_search<
+        detail::packed_key_t<detail::key_range(items)>>;
+    return ordered_map<typename PairT::first_type, typename PairT::second_type,
+                       std::size(items),
+                       std::less<typename PairT::first_type>, SearchT>{items};
+}
+
+/* Map with a weighted keyset (see make_weighted_ordered_keyset) */
+template <size_t HotCount = 4, typename Search = auto_search>
+static consteval auto make_weighted_ordered_map(comp_time auto builder,
+                                                comp_time auto weights) {
+    constexpr auto items = builder();
+    using PairT = std::remove_cvref_t<decltype(*std::begin(items))>;
+    constexpr auto hot = detail::hottest_keys<
+        detail::hot_count<HotCount>(items, weights())>(items, weights());
+    return ordered_map<typename PairT::first_type, typename PairT::second_type,
+                       std::size(items),
+                       std::less<typename PairT::first_type>,
+                       hot_key_search<hot, Search>>{items};
+}
+
+/* Range lookups return subspans over the sorted entries */
+static constexpr auto range_om = make_ordered_map(
+    std::array{std::pair{40, 4}, std::pair{10, 1}, std::pair{30, 3},
+               std::pair{20, 2}});
+static_assert(range_om.lower_bound(20).size() == 3);
+static_assert((*range_om.lower_bound(25).begin()).second == 3);
+static_assert(range_om.lower_bound(41).empty());
+static_assert(range_om.upper_bound(20).size() == 2);
+static_assert(range_om.upper_bound(5).size() == 4);
+static_assert(range_om.equal_range(30).size() == 1);
+static_assert(range_om.equal_range(35).empty());
+static_assert(range_om.range(15, 40).size() == 2);
+static_assert(range_om.range(10, 41).size() == 4);
+static_assert(range_om.range(40, 10).empty());
+
+/* Packed maps iterate & search spans through the rebuilt keys */
+static constexpr auto packed_om = make_packed_ordered_map([] {
+    return std::array{std::pair{1300, 3}, std::pair{1000, 0},
+                      std::pair{1200, 2}, std::pair{1100, 1}};
+});
+static_assert(sizeof(packed_om) == sizeof(int) + 4 * sizeof(std::uint16_t) +
+                                       4 * sizeof(int));
+static_assert((*packed_om.begin()).first == 1000);
+static_assert((*(packed_om.end() - 1)).second == 3);
+static_assert(packed_om.lower_bound(1150).size() == 2);
+static_assert((*packed_om.range(1050, 1250).begin()).first == 1100);
+static_assert(packed_om.range(1050, 1250).contains(1200));
+static_assert(!packed_om.range(1050, 1250).contains(1300));
+
 }; // namespace heurohash
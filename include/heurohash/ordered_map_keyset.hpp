@@ -3,20 +3,35 @@
 #include <algorithm>
 #include <cstddef>
 #include <functional>
+#include <limits>
+#include <span>
 #include <utility>
 
 #include "detail/branchless_lower_bound.hpp"
+#include "detail/comp_time_arg.hpp"
+#include "detail/ordered_search.hpp"
 #include "detail/traits.hpp"
 
 namespace heurohash {
-template <typename KeyT, size_t Size, typename Compare = std::less<KeyT>>
+/* Search picks the lookup strategy (see detail/ordered_search.hpp) */
+template <typename KeyT, size_t Size, typename Compare = std::less<KeyT>,
+          typename Search = auto_search>
 class ordered_map_keyset {
     using KeyUnderlyingT = detail::underlying_type<KeyT>;
     using KeyValT = std::remove_cv_t<KeyT>;
     using KeyStorageT = std::array<KeyValT, Size>;
+    using SearchIndexT = typename Search::template index<KeyValT, Size>;
 
-    KeyStorageT keys{};
+    /* The keyset keeps the sorted keys, unless the search index holds them
+     * (e.g. packed, see frame_of_reference_search) */
+    static constexpr bool index_stores_keys =
+        detail::index_stores_keys_v<SearchIndexT, Compare>;
+    struct no_keys {};
+    using KeysT = std::conditional_t<index_stores_keys, no_keys, KeyStorageT>;
+
+    [[no_unique_address]] KeysT keys{};
     [[no_unique_address]] Compare compare;
+    [[no_unique_address]] SearchIndexT search_index{};
 
   public:
     static constexpr size_t keyset_size = Size;
@@ -30,9 +45,11 @@ class ordered_map_keyset {
     using const_reference = const value_type &;
     using pointer = value_type *;
     using const_pointer = const value_type *;
-    using const_iterator = typename KeyStorageT::const_iterator;
+    using const_iterator = typename std::conditional_t<
+        index_stores_keys, SearchIndexT, KeyStorageT>::const_iterator;
 
     using compare_type = Compare;
+    using search_type = Search;
     using storage_type = KeyValT;
 
     template <typename InputIt>
@@ -41,8 +58,13 @@ class ordered_map_keyset {
         : compare(comp) {
         constexpr_assert(std::distance(first, last) == Size,
                          "Passed array size doesn't match");
-        std::copy(first, last, keys.begin());
-        sort_keys();
+        KeyStorageT sorted{};
+        std::copy(first, last, sorted.begin());
+        sort_keys(sorted);
+        search_index = SearchIndexT{sorted};
+        if constexpr (!index_stores_keys) {
+            keys = sorted;
+        }
     }
 
     consteval ordered_map_keyset(std::initializer_list<key_type> lst,
@@ -73,8 +95,34 @@ class ordered_map_keyset {
         return find_impl(key);
     }
 
+    /* Batched find, out[i] = find(in[i]). Searches the sorted keys with
+     * interleaved lower bounds (whatever the Search) */
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<value_type> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        find_many_impl(in, [&](size_t i, size_t idx) { out[i] = idx; });
+    }
+
+    /* Batched lower bound, out[i] = index of the first key not less than in[i]
+     * (Size if none) */
+    constexpr void lower_bound_many(std::span<const key_type> in,
+                                    std::span<value_type> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        detail::branchless_lower_bound_many(
+            begin(), Size, in.data(), in.size(), compare,
+            [&](size_t i, size_t idx) { out[i] = idx; });
+    }
+
+    /* Calls emit(input_idx, found_idx) for every key in input */
+    template <typename Func>
+    constexpr void find_many_impl(std::span<const key_type> in,
+                                  Func &&emit) const noexcept {
+        detail::ordered_find_many_impl(begin(), Size, in.data(), in.size(),
+                                       compare, std::forward<Func>(emit));
+    }
+
     constexpr size_type count(const key_type &key) const noexcept {
-        return contains() ? 1 : 0;
+        return contains(key) ? 1 : 0;
     }
 
     constexpr bool contains(const key_type &key) const noexcept {
@@ -90,21 +138,43 @@ class ordered_map_keyset {
 
     constexpr compare_type key_comp() const noexcept { return compare; }
 
-    constexpr const_iterator begin() const noexcept { return keys.cbegin(); }
+    constexpr const_iterator begin() const noexcept {
+        if constexpr (index_stores_keys) {
+            return search_index.begin();
+        } else {
+            return keys.cbegin();
+        }
+    }
+
+    constexpr const_iterator end() const noexcept { return begin() + Size; }
 
-    constexpr const_iterator end() const noexcept { return keys.cend(); }
+    /* Passed to spans alongside this keyset, so they search through the
+     * index instead of the sorted keys (nullptr if it has no index) */
+    constexpr detail::ordered_search_fn<KeyT> search_fn() const noexcept {
+        if constexpr (SearchIndexT::searches_sorted_keys) {
+            return nullptr;
+        } else {
+            return [](const void *self, const KeyT &key) -> size_t {
+                return static_cast<const ordered_map_keyset *>(self)
+                    ->find_impl(key);
+            };
+        }
+    }
 
   private:
-    constexpr void sort_keys() noexcept {
-        std::sort(keys.begin(), keys.end(), compare);
-        auto adjacent_val = std::adjacent_find(keys.cbegin(), keys.cend());
-        constexpr_assert(adjacent_val == keys.cend(),
+    constexpr void sort_keys(KeyStorageT &sorted) noexcept {
+        std::sort(sorted.begin(), sorted.end(), compare);
+        auto adjacent_val = std::adjacent_find(sorted.cbegin(), sorted.cend());
+        constexpr_assert(adjacent_val == sorted.cend(),
                          "Duplicate entries in keys");
     }
 
     constexpr size_t find_impl(const KeyT &key) const noexcept {
-        return detail::ordered_find_impl_cast(keys.data(), keys.size(), key,
-                                              compare);
+        if constexpr (index_stores_keys) {
+            return search_index.find(key);
+        } else {
+            return search_index.find(keys, key, compare);
+        }
     }
 };
 
@@ -130,4 +200,157 @@ static consteval auto make_ordered_keyset(std::array<T, N> const &items,
     return ordered_map_keyset<T, N, Compare>{items, compare};
 }
 
+/* Keyset searched over its keys stored as offsets from the smallest one, in
+ * the narrowest unsigned type fitting the key range (see
+ * frame_of_reference_search) */
+static consteval auto make_packed_ordered_keyset(comp_time auto builder) {
+    constexpr auto items = builder();
+    using KeyT = std::remove_cvref_t<decltype(*std::begin(items))>;
+    using SearchT = frame_of_reference_search<
+        detail::packed_key_t<detail::key_range(items)>>;
+    return ordered_map_keyset<KeyT, std::size(items), std::less<KeyT>,
+                              SearchT>{items};
+}
+
+/* Keyset checking its HotCount most accessed keys (per the weights builder's
+ * {key, weight} table, see frequency_recorder) before searching with Search */
+template <size_t HotCount = 4, typename Search = auto_search>
+static consteval auto make_weighted_ordered_keyset(comp_time auto builder,
+                                                   comp_time auto weights) {
+    constexpr auto items = builder();
+    using KeyT = std::remove_cvref_t<decltype(*std::begin(items))>;
+    constexpr auto hot = detail::hottest_keys<
+        detail::hot_count<HotCount>(items, weights())>(items, weights());
+    return ordered_map_keyset<KeyT, std::size(items), std::less<KeyT>,
+                              hot_key_search<hot, Search>>{items};
+}
+
+/* The default search (linear scan for tiny keysets) stores nothing besides
+ * the keys */
+static constexpr auto scan_kst = make_ordered_keyset(std::array{5, 1, 4, 2, 3});
+static_assert(sizeof(scan_kst) == 5 * sizeof(int));
+static_assert(alignof(decltype(scan_kst)) == alignof(int));
+static_assert(scan_kst.find(1) == 0);
+static_assert(scan_kst.find(5) == 4);
+static_assert(scan_kst.find(6) == 5);
+static_assert(scan_kst.count(3) == 1 && scan_kst.count(0) == 0);
+
+/* One prefetched (line aligned) line holds every descendant that many levels
+ * down */
+static_assert(eytzinger_search::index<std::uint8_t, 100>::prefetch_levels == 6);
+static_assert(eytzinger_search::index<int, 100>::prefetch_levels == 4);
+static_assert(eytzinger_search::index<std::uint64_t, 100>::prefetch_levels ==
+              3);
+static_assert(alignof(eytzinger_search::index<int, 100>) ==
+              detail::cache_line_size);
+
+/* A packed keyset stores only the smallest key & the offsets from it,
+ * iteration rebuilds the keys */
+static constexpr auto packed_kst = make_packed_ordered_keyset(
+    [] { return std::array{-100, 100, -98, 0, 27, 5, 6, 7}; });
+static_assert(sizeof(packed_kst) == sizeof(int) + 8 * sizeof(std::uint8_t));
+static_assert(packed_kst.begin()[0] == -100);
+static_assert(packed_kst.begin()[1] == -98);
+static_assert(packed_kst.end()[-1] == 100);
+static_assert(packed_kst.end() - packed_kst.begin() == 8);
+static_assert(packed_kst.find(27) == 6);
+static_assert(packed_kst.find(-99) == 8);
+static_assert(packed_kst.find(101) == 8);
+
+/* Batched searches (groups of 16 lower bounds in lockstep) match the single
+ * ones, for keys below, between, on & above the keys */
+template <auto &Keyset, size_t Count> consteval bool check_lower_bound_many() {
+    using KeyT = typename std::remove_cvref_t<decltype(Keyset)>::key_type;
+    std::array<KeyT, Count> in{};
+    for (size_t i = 0; i < Count; ++i) {
+        in[i] = static_cast<KeyT>(static_cast<int>(i) * 7 - 20);
+    }
+    std::array<size_t, Count> bounds{};
+    std::array<size_t, Count> found{};
+    Keyset.lower_bound_many(in, bounds);
+    Keyset.find_many(in, found);
+    for (size_t i = 0; i < Count; ++i) {
+        auto const first =
+            std::lower_bound(Keyset.begin(), Keyset.end(), in[i]);
+        if (bounds[i] != static_cast<size_t>(first - Keyset.begin()) ||
+            found[i] != Keyset.find(in[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static constexpr auto many_kst = make_ordered_keyset([] {
+    std::array<int, 40> keys{};
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = static_cast<int>(i) * 3;
+    }
+    return keys;
+}());
+/* A partial group, then two full groups & a partial one */
+static_assert(check_lower_bound_many<scan_kst, 5>());
+static_assert(check_lower_bound_many<many_kst, 5>());
+static_assert(check_lower_bound_many<many_kst, 37>());
+static_assert(check_lower_bound_many<packed_kst, 37>());
+
+/* learned_search finds every key, however far off its model is, & misses
+ * keys in between, below & above. key_of(i) must be ascending with gaps */
+template <typename Search, size_t Size>
+consteval bool check_learned(auto key_of) {
+    std::array<int, Size> keys{};
+    for (size_t i = 0; i < Size; ++i) {
+        keys[i] = key_of(static_cast<int>(i));
+    }
+    auto const keyset =
+        ordered_map_keyset<int, Size, std::less<int>, Search>{keys};
+    for (size_t i = 0; i < Size; ++i) {
+        if (keyset.find(keys[i]) != i || keyset.find(keys[i] + 1) != Size) {
+            return false;
+        }
+    }
+    return keyset.find(keys[0] - 1) == Size &&
+           keyset.find(std::numeric_limits<int>::min()) == Size &&
+           keyset.find(std::numeric_limits<int>::max()) == Size;
+}
+static_assert(check_learned<interpolation_search, 50>(
+    [](int i) { return 3 * i - 70; }));
+/* Skewed keys, the line is far off, so the error window is wide */
+static_assert(check_learned<interpolation_search, 50>(
+    [](int i) { return 2 * i * i - 500; }));
+static_assert(check_learned<learned_search<4>, 50>(
+    [](int i) { return 2 * i * i - 500; }));
+/* More segments than keys */
+static_assert(check_learned<learned_search<8>, 5>(
+    [](int i) { return 10 * i; }));
+static_assert(check_learned<learned_search<4>, 1>([](int) { return -3; }));
+
+/* Only weighted keys are hot (at most HotCount of them, heaviest first), keys
+ * missing from the keyset are ignored */
+static constexpr auto hot_kst_keys = [] {
+    return std::array{50, 10, 40, 20, 30, 60, 70};
+};
+static constexpr auto hot_kst_weights = [] {
+    return std::array{std::pair{70, 5}, std::pair{999, 50}, std::pair{40, 100}};
+};
+static_assert(detail::hot_count<4>(hot_kst_keys(), hot_kst_weights()) == 2);
+static_assert(detail::hot_count<1>(hot_kst_keys(), hot_kst_weights()) == 1);
+static_assert(detail::hottest_keys<2>(hot_kst_keys(), hot_kst_weights()) ==
+              std::array{40, 70});
+
+static constexpr auto hot_kst =
+    make_weighted_ordered_keyset(hot_kst_keys, hot_kst_weights);
+static_assert(hot_kst.find(10) == 0);
+static_assert(hot_kst.find(40) == 3);
+static_assert(hot_kst.find(70) == 6);
+static_assert(hot_kst.find(45) == 7);
+
+/* Hot keys are answered from their ranks, without searching the keys */
+static_assert([] {
+    using IndexT = hot_key_search<std::array{40, 70}>::index<int, 7>;
+    auto const index = IndexT{std::array{10, 20, 30, 40, 50, 60, 70}};
+    auto const zeroes = std::array<int, 7>{};
+    return index.find(zeroes, 40, std::less<int>{}) == 3 &&
+           index.find(zeroes, 70, std::less<int>{}) == 6;
+}());
+
 }; // namespace heurohash
@@ -3,27 +3,39 @@
 #include <algorithm>
 #include <functional>
 #include <numeric>
+#include <span>
 
 #include "detail/branchless_lower_bound.hpp"
+#include "detail/ordered_search.hpp"
 #include "detail/traits.hpp"
+
+#include "atomic_value.hpp"
 #include "kvp_ptr_iterator.hpp"
 
 namespace heurohash {
 
 /* FWD declare ordered_map & ordered_map_valueset for span friend */
-template <typename KeyT, typename ValueT, size_t Size, typename Compare>
+template <typename KeyT, typename ValueT, size_t Size, typename Compare,
+          typename Search>
 class ordered_map;
 
-template <typename KeyT, typename ValueT, size_t Size, typename Compare>
+template <typename KeyT, typename ValueT, size_t Size, typename Compare,
+          typename Search>
 class ordered_map_valueset;
 
-/* Span of linear map (aka desized, to allow better 'anonymous' interfaces) */
-template <typename KeyT, typename ValueT, typename Compare = std::less<KeyT>>
+/* Span of linear map (aka desized, to allow better 'anonymous' interfaces).
+ * KeyPtrT addresses the sorted keys, a plain pointer unless the keyset stores
+ * them differently (e.g. detail::packed_key_iterator) */
+template <typename KeyT, typename ValueT, typename Compare = std::less<KeyT>,
+          typename KeyPtrT = const KeyT *>
 class ordered_map_span {
-    const KeyT *key_storage;
+    KeyPtrT key_storage;
     ValueT *value_storage;
     size_t stor_size;
     [[no_unique_address]] Compare compare;
+    /* Keyset & its find, if it has a search index (see search_fn()) */
+    const void *search_index;
+    detail::ordered_search_fn<KeyT> search_fn;
 
   public:
     /* Member types */
@@ -36,21 +48,27 @@ class ordered_map_span {
     using const_reference = const value_type &;
     using pointer = value_type *;
     using const_pointer = const value_type *;
-    using iterator = kvp_ptr_iterator<KeyT, ValueT>;
-    using const_iterator = kvp_ptr_iterator<KeyT, const ValueT>;
+    using iterator = kvp_ptr_iterator<KeyT, ValueT, KeyPtrT>;
+    using const_iterator = kvp_ptr_iterator<KeyT, const ValueT, KeyPtrT>;
 
   protected:
-    template <typename Key, typename Value, size_t Size, typename Comp>
+    template <typename Key, typename Value, size_t Size, typename Comp,
+              typename Search>
     friend class ordered_map;
 
-    template <typename Key, typename Value, size_t Size, typename Comp>
+    template <typename Key, typename Value, size_t Size, typename Comp,
+              typename Search>
     friend class ordered_map_valueset;
 
+    template <typename Key, typename Value, typename Comp, typename KeyPtr>
+    friend class ordered_map_span;
+
     explicit constexpr ordered_map_span(
-        const KeyT *keys, ValueT *values, size_t size,
-        const Compare &comp = Compare{}) noexcept
+        KeyPtrT keys, ValueT *values, size_t size,
+        const Compare &comp = Compare{}, const void *index = nullptr,
+        detail::ordered_search_fn<KeyT> index_find = nullptr) noexcept
         : key_storage{keys}, value_storage{values}, stor_size(size),
-          compare(comp) {}
+          compare(comp), search_index(index), search_fn(index_find) {}
 
   public:
     constexpr ordered_map_span(const ordered_map_span &) noexcept = default;
@@ -60,10 +78,11 @@ class ordered_map_span {
     constexpr ordered_map_span &
     operator=(ordered_map_span &&) noexcept = default;
 
-    constexpr
-    operator ordered_map_span<KeyT, const ValueT, Compare>() const noexcept {
-        return ordered_map_span<KeyT, const ValueT, Compare>(
-            key_storage, value_storage, stor_size, compare);
+    constexpr operator ordered_map_span<KeyT, const ValueT, Compare, KeyPtrT>()
+        const noexcept {
+        return ordered_map_span<KeyT, const ValueT, Compare, KeyPtrT>(
+            key_storage, value_storage, stor_size, compare, search_index,
+            search_fn);
     }
 
     /* Lookup */
@@ -71,6 +90,36 @@ class ordered_map_span {
         return value_storage + find_impl(key);
     }
 
+    /* Batched find, out[i] = index of in[i] (size() if not found). Runs
+     * several binary searches over the sorted keys in lockstep, prefetching
+     * each one's next probe, so their cache misses overlap */
+    constexpr void find_many(std::span<const KeyT> in,
+                             std::span<size_t> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        detail::ordered_find_many_impl(
+            key_storage, stor_size, in.data(), in.size(), compare,
+            [&](size_t i, size_t idx) { out[i] = idx; });
+    }
+
+    /* Batched find, out[i] = find(in[i]) */
+    constexpr void find_many(std::span<const KeyT> in,
+                             std::span<ValueT *> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        detail::ordered_find_many_impl(
+            key_storage, stor_size, in.data(), in.size(), compare,
+            [&](size_t i, size_t idx) { out[i] = value_storage + idx; });
+    }
+
+    /* Batched lower bound, out[i] = index of the first key not less than
+     * in[i] (size() if none) */
+    constexpr void lower_bound_many(std::span<const KeyT> in,
+                                    std::span<size_t> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        detail::branchless_lower_bound_many(
+            key_storage, stor_size, in.data(), in.size(), compare,
+            [&](size_t i, size_t idx) { out[i] = idx; });
+    }
+
     constexpr reference operator[](const KeyT &key) const noexcept {
         return value_storage[find_impl(key)];
     }
@@ -82,13 +131,38 @@ class ordered_map_span {
     }
 
     constexpr size_type count(const KeyT &key) const noexcept {
-        return contains() ? 1 : 0;
+        return contains(key) ? 1 : 0;
     }
 
     constexpr bool contains(const KeyT &key) const noexcept {
         return find_impl(key) != size();
     }
 
+    /* Range lookups, all return subspans over the same key/value storage.
+     * lower_bound/upper_bound span from the first key not less than/greater
+     * than key to the end */
+    constexpr ordered_map_span lower_bound(const KeyT &key) const noexcept {
+        return subspan(lower_bound_idx(key));
+    }
+
+    constexpr ordered_map_span upper_bound(const KeyT &key) const noexcept {
+        return subspan(upper_bound_idx(key));
+    }
+
+    /* Entries equivalent to key (at most one) */
+    constexpr ordered_map_span equal_range(const KeyT &key) const noexcept {
+        auto first = lower_bound_idx(key);
+        return subspan(first, upper_bound_idx(key) - first);
+    }
+
+    /* Entries with keys in [lo, hi) */
+    constexpr ordered_map_span range(const KeyT &lo,
+                                     const KeyT &hi) const noexcept {
+        auto first = lower_bound_idx(lo);
+        auto last = std::max(first, lower_bound_idx(hi));
+        return subspan(first, last - first);
+    }
+
     constexpr bool empty() const noexcept { return stor_size == 0; }
 
     constexpr size_t size() const noexcept { return stor_size; }
@@ -107,10 +181,11 @@ class ordered_map_span {
         std::fill(value_storage, value_storage + stor_size, ValueT{});
     }
 
-    constexpr ordered_map_span<KeyT, ValueT, Compare>
+    constexpr ordered_map_span
     subspan(size_t offset,
             size_t count = std::numeric_limits<size_t>::max()) const noexcept {
         /* FIXME: Size validation here */
+        /* The search index covers the whole keyset, so it's dropped */
         auto new_size = size() - offset;
         new_size = std::min(count, new_size);
         return ordered_map_span{key_storage + offset, value_storage + offset,
@@ -118,9 +193,29 @@ class ordered_map_span {
     }
 
   private:
+    constexpr size_t lower_bound_idx(const KeyT &key) const noexcept {
+        return detail::branchless_lower_bound(
+                   key_storage, key_storage + stor_size, key, compare) -
+               key_storage;
+    }
+
+    constexpr size_t upper_bound_idx(const KeyT &key) const noexcept {
+        return detail::branchless_upper_bound(
+                   key_storage, key_storage + stor_size, key, compare) -
+               key_storage;
+    }
+
     constexpr size_t find_impl(const KeyT &key) const noexcept {
+        if (search_fn != nullptr && !std::is_constant_evaluated()) {
+            return search_fn(search_index, key);
+        }
         return detail::ordered_find_impl_cast(key_storage, stor_size, key,
                                               compare);
     }
 };
+
+/* Span of atomic_ordered_map/atomic_ordered_map_valueset */
+template <typename KeyT, typename ValueT, typename Compare = std::less<KeyT>>
+using atomic_ordered_map_span =
+    ordered_map_span<KeyT, atomic_value<ValueT>, Compare>;
 }; // namespace heurohash
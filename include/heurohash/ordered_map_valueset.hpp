@@ -1,5 +1,7 @@
 #pragma once
 
+#include <span>
+
 #include "detail/traits.hpp"
 
 #include "kvp_ptr_iterator.hpp"
@@ -8,10 +10,11 @@
 
 namespace heurohash {
 template <typename KeyT, typename ValueT, size_t Size,
-          typename Compare = std::less<KeyT>>
+          typename Compare = std::less<KeyT>, typename Search = auto_search>
 class ordered_map_valueset {
     using StorageT = std::array<ValueT, Size>;
-    using KeysetT = ordered_map_keyset<KeyT, Size, Compare>;
+    using KeysetT = ordered_map_keyset<KeyT, Size, Compare, Search>;
+    using KeyPtrT = typename KeysetT::const_iterator;
     /* FIXME: Move ordered_map & ordered_map_valueset into a common class where
      * KeysetT can be controlled */
     const KeysetT &keyset;
@@ -28,8 +31,8 @@ class ordered_map_valueset {
     using const_reference = const value_type &;
     using pointer = value_type *;
     using const_pointer = const value_type *;
-    using iterator = kvp_ptr_iterator<KeyT, ValueT>;
-    using const_iterator = kvp_ptr_iterator<KeyT, const ValueT>;
+    using iterator = kvp_ptr_iterator<KeyT, ValueT, KeyPtrT>;
+    using const_iterator = kvp_ptr_iterator<KeyT, const ValueT, KeyPtrT>;
 
     template <typename InputIt>
     static constexpr std::array<KeyT, Size> extract_keys(InputIt first,
@@ -88,6 +91,23 @@ class ordered_map_valueset {
         return values.cbegin() + keyset.find(key);
     }
 
+    /* Batched find, out[i] = find(in[i]) (i.e. end() if not found) */
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<ValueT *> out) noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        keyset.find_many_impl(in, [&](size_t i, size_t idx) {
+            out[i] = values.begin() + idx;
+        });
+    }
+
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<const ValueT *> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        keyset.find_many_impl(in, [&](size_t i, size_t idx) {
+            out[i] = values.cbegin() + idx;
+        });
+    }
+
     constexpr ValueT &operator[](const KeyT &key) noexcept {
         return values[keyset.find(key)];
     }
@@ -109,7 +129,7 @@ class ordered_map_valueset {
     }
 
     constexpr size_type count(const key_type &key) const noexcept {
-        return contains() ? 1 : 0;
+        return contains(key) ? 1 : 0;
     }
 
     constexpr bool contains(const key_type &key) const noexcept {
@@ -137,42 +157,80 @@ class ordered_map_valueset {
     }
 
     constexpr const_iterator end() const noexcept {
-        return iterator{keyset.end(), values.cend()};
+        return const_iterator{keyset.end(), values.cend()};
+    }
+
+    /* Range lookups, return subspans (see ordered_map_span) */
+    constexpr auto lower_bound(const KeyT &key) noexcept {
+        return to_span().lower_bound(key);
+    }
+
+    constexpr auto lower_bound(const KeyT &key) const noexcept {
+        return to_span().lower_bound(key);
+    }
+
+    constexpr auto upper_bound(const KeyT &key) noexcept {
+        return to_span().upper_bound(key);
+    }
+
+    constexpr auto upper_bound(const KeyT &key) const noexcept {
+        return to_span().upper_bound(key);
+    }
+
+    constexpr auto equal_range(const KeyT &key) noexcept {
+        return to_span().equal_range(key);
+    }
+
+    constexpr auto equal_range(const KeyT &key) const noexcept {
+        return to_span().equal_range(key);
+    }
+
+    constexpr auto range(const KeyT &lo, const KeyT &hi) noexcept {
+        return to_span().range(lo, hi);
+    }
+
+    constexpr auto range(const KeyT &lo, const KeyT &hi) const noexcept {
+        return to_span().range(lo, hi);
     }
 
     constexpr void clear() noexcept { values.fill(ValueT{}); }
 
-    constexpr operator ordered_map_span<KeyT, ValueT, Compare>() noexcept {
+    constexpr
+    operator ordered_map_span<KeyT, ValueT, Compare, KeyPtrT>() noexcept {
         return to_span();
     }
 
-    constexpr
-    operator ordered_map_span<KeyT, const ValueT, Compare>() const noexcept {
+    constexpr operator ordered_map_span<KeyT, const ValueT, Compare, KeyPtrT>()
+        const noexcept {
         return to_span();
     }
 
     constexpr auto to_span() noexcept {
-        return ordered_map_span<KeyT, ValueT, Compare>(
-            keyset.begin(), values.data(), Size, keyset.key_comp());
+        return ordered_map_span<KeyT, ValueT, Compare, KeyPtrT>(
+            keyset.begin(), values.data(), Size, keyset.key_comp(), &keyset,
+            keyset.search_fn());
     }
 
     constexpr auto to_span() const noexcept {
-        return ordered_map_span<KeyT, const ValueT, Compare>(
-            keyset.begin(), values.data(), Size, keyset.key_comp());
+        return ordered_map_span<KeyT, const ValueT, Compare, KeyPtrT>(
+            keyset.begin(), values.data(), Size, keyset.key_comp(), &keyset,
+            keyset.search_fn());
     }
 };
 
-template <typename T, typename U, std::size_t N>
-static consteval auto
-make_ordered_map_valueset(const ordered_map_keyset<T, N> &keyset) {
-    return ordered_map_valueset<T, U, N>{keyset};
+template <typename T, typename U, std::size_t N,
+          typename Compare = std::less<T>, typename Search = auto_search>
+static consteval auto make_ordered_map_valueset(
+    const ordered_map_keyset<T, N, Compare, Search> &keyset) {
+    return ordered_map_valueset<T, U, N, Compare, Search>{keyset};
 }
 
-template <typename T, typename U, std::size_t N>
-static consteval auto
-make_ordered_map_valueset(const ordered_map_keyset<T, N> &keyset,
-                          std::array<std::pair<T, U>, N> const &items) {
-    return ordered_map_valueset<T, U, N>{keyset, items};
+template <typename T, typename U, std::size_t N,
+          typename Compare = std::less<T>, typename Search = auto_search>
+static consteval auto make_ordered_map_valueset(
+    const ordered_map_keyset<T, N, Compare, Search> &keyset,
+    std::array<std::pair<T, U>, N> const &items) {
+    return ordered_map_valueset<T, U, N, Compare, Search>{keyset, items};
 }
 
 template <typename T, typename U, std::size_t N>
@@ -201,4 +259,26 @@ make_ordered_map_valueset(std::array<std::pair<T, U>, N> const &items,
     return ordered_map_valueset<T, U, N, Compare>{items, compare};
 }
 
+/* ordered_map_valueset with atomically accessed values (see atomic_value) */
+template <typename KeyT, typename ValueT, size_t Size,
+          typename Compare = std::less<KeyT>, typename Search = auto_search>
+using atomic_ordered_map_valueset =
+    ordered_map_valueset<KeyT, atomic_value<ValueT>, Size, Compare, Search>;
+
+template <typename T, typename U, std::size_t N,
+          typename Compare = std::less<T>, typename Search = auto_search>
+static consteval auto make_atomic_ordered_map_valueset(
+    const ordered_map_keyset<T, N, Compare, Search> &keyset) {
+    return atomic_ordered_map_valueset<T, U, N, Compare, Search>{keyset};
+}
+
+template <typename T, typename U, std::size_t N,
+          typename Compare = std::less<T>, typename Search = auto_search>
+static consteval auto make_atomic_ordered_map_valueset(
+    const ordered_map_keyset<T, N, Compare, Search> &keyset,
+    std::array<std::pair<T, U>, N> const &items) {
+    return atomic_ordered_map_valueset<T, U, N, Compare, Search>{
+        keyset, items.begin(), items.end()};
+}
+
 }; // namespace heurohash
@@ -0,0 +1,529 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+#include "detail/comp_time_arg.hpp"
+#include "detail/traits.hpp"
+
+/*
+ * Two-level direct map, for integral keys clustered in dense islands across a
+ * wide range. The key's slot (key - smallest key) is split into a page (high
+ * bits) & an offset within the page (low PageBits bits). The page directory
+ * points each page at a leaf page, holding the index of every slot's value
+ * (Size for holes). Pages without any keys all share one sentinel leaf, so
+ * memory scales with the populated pages rather than the key range. Leaf
+ * entries & leaf numbers are the narrowest type holding Size (there are at
+ * most Size populated pages). Spans don't know Size, so they carry that
+ * width as a run-time value instead.
+ */
+
+namespace heurohash {
+namespace detail {
+/// Leaf entries & directory leaf numbers of a paged map of Size keys
+template <size_t Size> using paged_index_t = ordered_index_t<Size>;
+
+/// Directory or leaf entries of a paged map of any size, as seen by spans.
+/// Only the member of the map's paged_index_t width is set
+union paged_index_ptr {
+    const std::uint8_t *u8;
+    const std::uint16_t *u16;
+    const std::uint32_t *u32;
+};
+
+template <typename IndexT>
+constexpr paged_index_ptr make_paged_index_ptr(const IndexT *ptr) noexcept {
+    paged_index_ptr result{};
+    if constexpr (std::is_same_v<IndexT, std::uint8_t>) {
+        result.u8 = ptr;
+    } else if constexpr (std::is_same_v<IndexT, std::uint16_t>) {
+        result.u16 = ptr;
+    } else {
+        static_assert(std::is_same_v<IndexT, std::uint32_t>);
+        result.u32 = ptr;
+    }
+    return result;
+}
+
+/// Most directory entries (pages) of a paged map, wider key ranges need
+/// larger pages
+inline constexpr size_t paged_max_pages = size_t{1} << 20U;
+
+template <typename T, typename IndexT>
+static constexpr size_t
+paged_find_impl(const T &key, T offset_from_zero, const IndexT *directory,
+                size_t pages, const IndexT *leaves, size_t page_bits,
+                size_t size) noexcept {
+    using UnsignedT = std::make_unsigned_t<T>;
+    /* Keys below offset_from_zero wrap around, past the last page */
+    auto slot = static_cast<size_t>(
+        static_cast<UnsignedT>(static_cast<UnsignedT>(key) -
+                               static_cast<UnsignedT>(offset_from_zero)));
+    auto page = slot >> page_bits;
+    if (page >= pages) {
+        return size;
+    }
+    auto leaf = static_cast<size_t>(directory[page]) << page_bits;
+    auto idx = static_cast<size_t>(
+        leaves[leaf + (slot & ((size_t{1} << page_bits) - 1))]);
+    return idx < size ? idx : size;
+}
+
+/// Number of leaf pages (populated pages + sentinel) of a paged map over
+/// items
+template <size_t PageBits, typename T, size_t S>
+constexpr size_t paged_leaf_count(const std::array<T, S> &items) noexcept {
+    auto key_of = [](const auto &item) {
+        if constexpr (requires { item.second; }) {
+            return item.first;
+        } else {
+            return item;
+        }
+    };
+    using KeyValT = underlying_type<decltype(key_of(items[0]))>;
+    using UnsignedT = std::make_unsigned_t<KeyValT>;
+    if constexpr (S == 0) {
+        return 1;
+    }
+    auto min = static_cast<KeyValT>(key_of(items[0]));
+    for (const auto &item : items) {
+        min = std::min(min, static_cast<KeyValT>(key_of(item)));
+    }
+    std::array<std::uint64_t, S> pages{};
+    std::transform(items.begin(), items.end(), pages.begin(),
+                   [&](const auto &item) {
+                       return static_cast<std::uint64_t>(static_cast<UnsignedT>(
+                                  static_cast<UnsignedT>(
+                                      static_cast<KeyValT>(key_of(item))) -
+                                  static_cast<UnsignedT>(min))) >>
+                              PageBits;
+                   });
+    std::sort(pages.begin(), pages.end());
+    return static_cast<size_t>(std::unique(pages.begin(), pages.end()) -
+                               pages.begin()) +
+           1;
+}
+}; // namespace detail
+
+/* FWD declare paged_map for span friend */
+template <typename KeyT, typename ValueT, size_t Size, size_t PageBits,
+          size_t Pages, size_t Leaves>
+class paged_map;
+
+/* Span of paged map (aka desized, to allow better 'anonymous' interfaces) */
+template <typename KeyT, typename ValueT> class paged_map_span {
+    using KeyValT = detail::underlying_type<KeyT>;
+    using StorageT = std::span<ValueT>;
+
+    StorageT data;
+    KeyValT offset_from_zero;
+    detail::paged_index_ptr directory;
+    size_t pages;
+    detail::paged_index_ptr leaves;
+    size_t page_bits;
+    /* log2 of the bytes per directory & leaf entry */
+    std::uint8_t index_shift;
+
+  public:
+    /* Member types */
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = mapped_type;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+    using pointer = value_type *;
+    using const_pointer = const value_type *;
+    using iterator = typename StorageT::iterator;
+
+  protected:
+    template <typename Key, typename Value, size_t Size, size_t PageBits,
+              size_t Pages, size_t Leaves>
+    friend class paged_map;
+
+    template <typename IndexT>
+    explicit constexpr paged_map_span(std::span<ValueT> _data, KeyValT offset,
+                                      const IndexT *_directory, size_t _pages,
+                                      const IndexT *_leaves,
+                                      size_t _page_bits) noexcept
+        : data(_data), offset_from_zero(offset),
+          directory(detail::make_paged_index_ptr(_directory)), pages(_pages),
+          leaves(detail::make_paged_index_ptr(_leaves)),
+          page_bits(_page_bits),
+          index_shift(static_cast<std::uint8_t>(
+              std::countr_zero(sizeof(IndexT)))) {}
+
+  public:
+    constexpr paged_map_span(const paged_map_span &) noexcept = default;
+    constexpr paged_map_span(paged_map_span &&) noexcept = default;
+    constexpr paged_map_span &
+    operator=(const paged_map_span &) noexcept = default;
+    constexpr paged_map_span &operator=(paged_map_span &&) noexcept = default;
+
+    /* Lookup */
+    constexpr iterator find(const KeyT &key) const noexcept {
+        return data.begin() + find_impl(key);
+    }
+
+    constexpr reference operator[](const KeyT &key) const noexcept {
+        return data[find_impl(key)];
+    }
+
+    constexpr reference at(const KeyT &key) const noexcept {
+        auto idx = find_impl(key);
+        constexpr_assert(idx != data.size(), "Key not found");
+        return data[idx];
+    }
+
+    constexpr size_type count(const KeyT &key) const noexcept {
+        return contains(key) ? 1 : 0;
+    }
+
+    constexpr bool contains(const KeyT &key) const noexcept {
+        return find_impl(key) != data.size();
+    }
+
+    constexpr bool empty() const noexcept { return data.empty(); }
+
+    constexpr size_t size() const noexcept { return data.size(); }
+
+    constexpr size_t max_size() const noexcept { return data.size(); }
+
+    constexpr iterator begin() const noexcept { return data.begin(); }
+
+    constexpr iterator end() const noexcept { return data.end(); }
+
+    constexpr void clear() noexcept {
+        std::fill(data.begin(), data.end(), ValueT{});
+    }
+
+    constexpr KeyValT get_key_offset() const noexcept {
+        return offset_from_zero;
+    }
+
+  private:
+    constexpr size_t find_impl(const KeyT &key) const noexcept {
+        /* A span sees a single map, so the branch always goes the same way */
+        if (index_shift == 0) {
+            return find_in(key, directory.u8, leaves.u8);
+        }
+        if (index_shift == 1) {
+            return find_in(key, directory.u16, leaves.u16);
+        }
+        return find_in(key, directory.u32, leaves.u32);
+    }
+
+    template <typename IndexT>
+    constexpr size_t find_in(const KeyT &key, const IndexT *dir,
+                             const IndexT *leaf) const noexcept {
+        return detail::paged_find_impl<KeyValT, IndexT>(
+            static_cast<KeyValT>(key), offset_from_zero, dir, pages, leaf,
+            page_bits, data.size());
+    }
+};
+
+/* Map over integral keys spanning Pages pages of 2^PageBits slots, Leaves - 1
+ * of which hold keys. Lookups are a page bounds check & two dependent loads
+ * (directory & leaf), with no key comparisons. Keys are discarded (values are
+ * stored in key order), see make_paged_map for the template arguments */
+template <typename KeyT, typename ValueT, size_t Size, size_t PageBits,
+          size_t Pages, size_t Leaves>
+class paged_map {
+    using KeyValT = detail::underlying_type<KeyT>;
+    using StorageT = std::array<ValueT, Size>;
+    using IndexT = detail::paged_index_t<Size>;
+    static_assert(std::is_integral_v<KeyValT>,
+                  "Type must be integral (suitable for indexing array)");
+    static_assert(PageBits < 32, "Pages too large");
+    static_assert(Size < UINT32_MAX, "Too many keys for paged_index_t");
+    static_assert(Leaves <= Size + 1, "More leaf pages than keys");
+    static_assert(Pages <= detail::paged_max_pages,
+                  "Page directory too large, use larger pages (PageBits)");
+    static constexpr size_t PageSize = size_t{1} << PageBits;
+
+    StorageT data{};
+    /* Leaf number of every page */
+    std::array<IndexT, Pages> directory{};
+    /* Leaf 0 is the sentinel page, shared by every page without keys */
+    std::array<IndexT, Leaves * PageSize> leaves{};
+    /* Key of slot 0 */
+    KeyValT offset_from_zero{};
+
+  public:
+    /* Member types */
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = mapped_type;
+    using pair_type = std::pair<key_type, value_type>;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+    using pointer = value_type *;
+    using const_pointer = const value_type *;
+    using iterator = typename StorageT::iterator;
+    using const_iterator = typename StorageT::const_iterator;
+
+    template <typename InputIt>
+    consteval paged_map(InputIt first, InputIt last) noexcept {
+        auto keys = check_prereqs(first, last);
+        if constexpr (Size != 0) {
+            offset_from_zero = keys.front();
+        }
+        leaves.fill(static_cast<IndexT>(Size));
+
+        /* Keys are sorted, so value indices follow key order & the pages of
+         * a leaf are allocated in order */
+        size_t next_leaf = 1;
+        for (size_t i = 0; i < Size; ++i) {
+            auto slot = slot_of(keys[i]);
+            auto page = slot >> PageBits;
+            if (directory[page] == 0) {
+                constexpr_assert(next_leaf < Leaves, "Too few leaf pages");
+                directory[page] = static_cast<IndexT>(next_leaf++);
+            }
+            leaves[directory[page] * PageSize + (slot & (PageSize - 1))] =
+                static_cast<IndexT>(i);
+        }
+        constexpr_assert(next_leaf == Leaves, "Too many leaf pages");
+
+        /* Copy over data if iterator is KVP */
+        if constexpr (requires { (*first).second; }) {
+            std::for_each(first, last, [this](const auto &kvp) {
+                data[find_impl(kvp.first)] = kvp.second;
+            });
+        }
+    }
+
+    consteval paged_map(std::initializer_list<pair_type> kvp_items) noexcept
+        : paged_map(kvp_items.begin(), kvp_items.end()) {}
+    consteval paged_map(std::initializer_list<key_type> key_items) noexcept
+        : paged_map(key_items.begin(), key_items.end()) {}
+
+    consteval paged_map(const std::array<pair_type, Size> &kvp_items) noexcept
+        : paged_map(kvp_items.begin(), kvp_items.end()) {}
+    consteval paged_map(const std::array<key_type, Size> &key_items) noexcept
+        : paged_map(key_items.begin(), key_items.end()) {}
+
+    consteval paged_map(const pair_type (&kvp_items)[Size]) noexcept
+        : paged_map(std::begin(kvp_items), std::end(kvp_items)) {}
+    consteval paged_map(const key_type (&key_items)[Size]) noexcept
+        : paged_map(std::begin(key_items), std::end(key_items)) {}
+
+    /* Copying can take place at run-time*/
+    constexpr paged_map(const paged_map &) noexcept = default;
+    constexpr paged_map &operator=(const paged_map &) noexcept = default;
+
+    /* Moving can take place at run-time*/
+    constexpr paged_map(paged_map &&) noexcept = default;
+    constexpr paged_map &operator=(paged_map &&) noexcept = default;
+
+    /* Lookup */
+    constexpr iterator find(const KeyT &key) noexcept {
+        return data.begin() + find_impl(key);
+    }
+
+    constexpr const_iterator find(const KeyT &key) const noexcept {
+        return data.begin() + find_impl(key);
+    }
+
+    constexpr ValueT &operator[](const KeyT &key) noexcept {
+        return data[find_impl(key)];
+    }
+
+    constexpr ValueT const &operator[](const KeyT &key) const noexcept {
+        return data[find_impl(key)];
+    }
+
+    constexpr ValueT const &at(const KeyT &key) const noexcept {
+        auto idx = find_impl(key);
+        constexpr_assert(idx != Size, "Key not found");
+        return data[idx];
+    }
+
+    constexpr ValueT &at(const KeyT &key) noexcept {
+        auto idx = find_impl(key);
+        constexpr_assert(idx != Size, "Key not found");
+        return data[idx];
+    }
+
+    constexpr size_type count(const KeyT &key) const noexcept {
+        return contains(key) ? 1 : 0;
+    }
+
+    constexpr bool contains(const KeyT &key) const noexcept {
+        return find_impl(key) != Size;
+    }
+
+    /* Capacity */
+    constexpr bool empty() const noexcept { return Size == 0; }
+
+    constexpr size_t size() const noexcept { return Size; }
+
+    constexpr size_t max_size() const noexcept { return Size; }
+
+    /* Iterators (values in key order) */
+    constexpr iterator begin() noexcept { return data.begin(); }
+
+    constexpr const_iterator begin() const noexcept { return data.cbegin(); }
+
+    constexpr iterator end() noexcept { return data.end(); }
+
+    constexpr const_iterator end() const noexcept { return data.cend(); }
+
+    constexpr const_iterator cbegin() const noexcept { return data.cbegin(); }
+
+    constexpr const_iterator cend() const noexcept { return data.cend(); }
+
+    constexpr void clear() noexcept { data.fill(ValueT{}); }
+
+    constexpr KeyValT get_key_offset() const noexcept {
+        return offset_from_zero;
+    }
+
+    /* Keys (in value order), rebuilt from the populated pages */
+    constexpr std::array<KeyT, Size> keys() const noexcept {
+        std::array<KeyT, Size> result{};
+        for (size_t page = 0; page < Pages; ++page) {
+            if (directory[page] == 0) {
+                continue;
+            }
+            for (size_t offset = 0; offset < PageSize; ++offset) {
+                auto idx = leaves[directory[page] * PageSize + offset];
+                if (idx < Size) {
+                    result[idx] = key_at_slot(page * PageSize + offset);
+                }
+            }
+        }
+        return result;
+    }
+
+    constexpr operator paged_map_span<KeyT, ValueT>() noexcept {
+        return to_span();
+    }
+
+    constexpr operator paged_map_span<KeyT, const ValueT>() const noexcept {
+        return to_span();
+    }
+
+    constexpr paged_map_span<KeyT, ValueT> to_span() noexcept {
+        return paged_map_span<KeyT, ValueT>(data, offset_from_zero,
+                                            directory.data(), Pages,
+                                            leaves.data(), PageBits);
+    }
+
+    constexpr paged_map_span<KeyT, const ValueT> to_span() const noexcept {
+        return paged_map_span<KeyT, const ValueT>(data, offset_from_zero,
+                                                  directory.data(), Pages,
+                                                  leaves.data(), PageBits);
+    }
+
+  private:
+    template <typename ItemT>
+    static constexpr KeyValT key_of(const ItemT &item) noexcept {
+        if constexpr (requires { item.second; }) {
+            return static_cast<KeyValT>(item.first);
+        } else {
+            return static_cast<KeyValT>(item);
+        }
+    }
+
+    constexpr size_t slot_of(KeyValT key) const noexcept {
+        using UnsignedT = std::make_unsigned_t<KeyValT>;
+        return static_cast<size_t>(static_cast<UnsignedT>(
+            static_cast<UnsignedT>(key) -
+            static_cast<UnsignedT>(offset_from_zero)));
+    }
+
+    constexpr KeyT key_at_slot(size_t slot) const noexcept {
+        using UnsignedT = std::make_unsigned_t<KeyValT>;
+        return static_cast<KeyT>(static_cast<KeyValT>(static_cast<UnsignedT>(
+            static_cast<UnsignedT>(offset_from_zero) + slot)));
+    }
+
+    /* Sorted keys */
+    template <typename InputIt>
+    static constexpr auto check_prereqs(InputIt begin, InputIt end) {
+        constexpr_assert(std::distance(begin, end) == Size, "Invalid size");
+        std::array<KeyValT, Size> prereq_arr{};
+        std::transform(begin, end, prereq_arr.begin(),
+                       [](const auto &item) { return key_of(item); });
+        std::sort(prereq_arr.begin(), prereq_arr.end());
+
+        auto adjacent_val =
+            std::adjacent_find(prereq_arr.cbegin(), prereq_arr.cend());
+        constexpr_assert(adjacent_val == prereq_arr.cend(),
+                         "Duplicate entries in keys");
+        constexpr_assert((detail::key_range(prereq_arr) >> PageBits) < Pages,
+                         "Keys must fit into Pages pages");
+        return prereq_arr;
+    }
+
+    constexpr size_t find_impl(const KeyT &key) const noexcept {
+        return detail::paged_find_impl<KeyValT, IndexT>(
+            static_cast<KeyValT>(key), offset_from_zero, directory.data(),
+            Pages, leaves.data(), PageBits, Size);
+    }
+};
+
+/* Paged map over the builder's (compile time) items, with pages of 2^PageBits
+ * slots. Smaller pages waste less on sparse islands, but grow the directory */
+template <size_t PageBits = 8>
+static consteval auto make_paged_map(comp_time auto builder) {
+    constexpr auto items = builder();
+    using PairT = std::remove_cvref_t<decltype(*std::begin(items))>;
+    return paged_map<typename PairT::first_type, typename PairT::second_type,
+                     std::size(items), PageBits,
+                     (detail::key_range(items) >> PageBits) + 1,
+                     detail::paged_leaf_count<PageBits>(items)>{items};
+}
+
+/* Two islands 0x0100-0x0107 & 0x0500-0x0503, holes in between: 129 pages of
+ * 8 slots, 2 of them hold keys */
+static constexpr auto paged_pm = make_paged_map<3>([] {
+    std::array<std::pair<int, int>, 12> kvps{};
+    for (int i = 0; i < 8; ++i) {
+        kvps[i] = {0x0100 + i, i};
+    }
+    for (int i = 0; i < 4; ++i) {
+        kvps[8 + i] = {0x0500 + i, 8 + i};
+    }
+    return kvps;
+});
+/* Values, then single byte directory (129) & leaf (3 * 8) entries, the key
+ * offset & padding */
+static_assert(sizeof(paged_pm) ==
+              12 * sizeof(int) + 129 + 24 + 3 + sizeof(int));
+static_assert(paged_pm.at(0x0100) == 0);
+static_assert(paged_pm.at(0x0107) == 7);
+static_assert(paged_pm.at(0x0500) == 8);
+static_assert(paged_pm.at(0x0503) == 11);
+static_assert(!paged_pm.contains(0x0108));
+static_assert(!paged_pm.contains(0x0300));
+static_assert(!paged_pm.contains(0x0504));
+static_assert(!paged_pm.contains(0x00ff));
+static_assert(!paged_pm.contains(-1));
+static_assert(!paged_pm.contains(0x10000));
+static_assert(paged_pm.to_span().at(0x0501) == 9);
+static_assert(!paged_pm.to_span().contains(0x00ff));
+
+/* 300 keys take 16 bit leaf entries, yet share the span type */
+static constexpr auto wide_paged_pm = make_paged_map<4>([] {
+    std::array<std::pair<int, int>, 300> kvps{};
+    for (int i = 0; i < 300; ++i) {
+        kvps[i] = {i * 3, i};
+    }
+    return kvps;
+});
+static_assert(std::is_same_v<decltype(paged_pm.to_span()),
+                             decltype(wide_paged_pm.to_span())>);
+static_assert(paged_map_span<int, const int>(paged_pm).at(0x0107) == 7);
+static_assert(paged_map_span<int, const int>(wide_paged_pm).at(897) == 299);
+static_assert(!paged_map_span<int, const int>(wide_paged_pm).contains(898));
+}; // namespace heurohash
@@ -4,6 +4,7 @@
 #include "pmh_map_keyset.hpp"
 
 #include "kvp_ptr_iterator.hpp"
+#include "pmh_map_aos.hpp"
 #include "pmh_map_span.hpp"
 #include <type_traits>
 // #include "ordered_map_keyset.hpp" #include "ordered_map_span.hpp"
@@ -34,8 +35,10 @@ class hash_map_collection {
     using const_reference = const value_type &;
     using pointer = value_type *;
     using const_pointer = const value_type *;
-    using iterator = kvp_ptr_iterator<key_type, ValueT>;
-    using const_iterator = kvp_ptr_iterator<key_type, const ValueT>;
+    using iterator =
+        kvp_ptr_iterator<key_type, ValueT, detail::hash_key_ptr_t<key_type>>;
+    using const_iterator = kvp_ptr_iterator<key_type, const ValueT,
+                                            detail::hash_key_ptr_t<key_type>>;
 
     /* Default initialize values */
     consteval hash_map_collection(KeyStorT &&key_storage) noexcept
@@ -83,6 +86,23 @@ class hash_map_collection {
         return value_stor.cbegin() + key_stor.find(key);
     }
 
+    /* Batched find, out[i] = find(in[i]) (i.e. end() if not found) */
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<ValueT *> out) noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        key_stor.find_many_impl(in, [&](size_t i, size_t idx) {
+            out[i] = value_stor.begin() + idx;
+        });
+    }
+
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<const ValueT *> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        key_stor.find_many_impl(in, [&](size_t i, size_t idx) {
+            out[i] = value_stor.cbegin() + idx;
+        });
+    }
+
     constexpr ValueT &operator[](const KeyT &key) noexcept {
         return value_stor[key_stor.find(key)];
     }
@@ -104,7 +124,7 @@ class hash_map_collection {
     }
 
     constexpr size_type count(const key_type &key) const noexcept {
-        return contains() ? 1 : 0;
+        return contains(key) ? 1 : 0;
     }
 
     constexpr bool contains(const key_type &key) const noexcept {
@@ -158,14 +178,23 @@ class hash_map_collection {
 template <typename KeysetT, typename ValueT>
 using hash_map = detail::hash_map_collection<KeysetT, ValueT, true>;
 
+template <typename Engine = pext_hash_engine>
 static consteval auto make_hash_map(comp_time auto builder) noexcept {
     constexpr auto values = builder();
     static_assert(lookup::detail::is_arr_kvp(values));
     using ValueStorT = decltype(lookup::detail::get_values(values));
     using ValueT = std::remove_cv_t<typename ValueStorT::value_type>;
-    using KeysetT = decltype(make_hash_keyset(builder));
-    return hash_map<KeysetT, ValueT>{make_hash_keyset(builder), values.begin(),
-                                     values.end()};
+    using KeysetT = decltype(make_hash_keyset<Engine>(builder));
+    return hash_map<KeysetT, ValueT>{make_hash_keyset<Engine>(builder),
+                                     values.begin(), values.end()};
+}
+
+/* Map with a weighted keyset (see make_weighted_hash_keyset) */
+template <typename Engine = pext_hash_engine>
+static consteval auto make_weighted_hash_map(comp_time auto builder,
+                                             comp_time auto weights) noexcept {
+    return make_hash_map<Engine>(
+        detail::weighted_builder<decltype(builder), decltype(weights)>{});
 }
 
 template <typename KeysetT, typename ValueT>
@@ -178,6 +207,7 @@ make_hash_map(KeysetT keyset,
 }
 
 template <typename KeysetT>
+    requires(!comp_time<KeysetT>)
 static consteval auto make_hash_map(KeysetT keyset) noexcept {
     return hash_map{keyset};
 }
@@ -186,9 +216,10 @@ template <typename KeyT, typename ValueT>
 using hash_map_valueset =
     detail::hash_map_collection<std::remove_cvref_t<KeyT>, ValueT, false>;
 
+template <typename Engine = pext_hash_engine>
 static consteval auto make_hash_valueset(comp_time auto builder) noexcept {
     constexpr auto values = builder();
-    static constexpr auto keyset = make_hash_keyset(builder);
+    static constexpr auto keyset = make_hash_keyset<Engine>(builder);
     using ValueStorT = decltype(lookup::detail::get_values(values));
     using ValueT = std::remove_cv_t<typename ValueStorT::value_type>;
     return hash_map_valueset<decltype(keyset), ValueT>{keyset, values.begin(),
@@ -209,4 +240,49 @@ static consteval auto make_hash_valueset(const KeysetT &keyset) noexcept {
     return hash_map_valueset<KeysetT, ValueT>{keyset};
 }
 
+/* Maps with atomically accessed values (see atomic_value) */
+template <typename KeysetT, typename ValueT>
+using atomic_hash_map = hash_map<KeysetT, atomic_value<ValueT>>;
+
+template <typename KeysetT, typename ValueT>
+using atomic_hash_map_valueset =
+    hash_map_valueset<KeysetT, atomic_value<ValueT>>;
+
+template <typename Engine = pext_hash_engine>
+static consteval auto make_atomic_hash_map(comp_time auto builder) noexcept {
+    constexpr auto values = builder();
+    using ValueStorT = decltype(lookup::detail::get_values(values));
+    using ValueT = std::remove_cv_t<typename ValueStorT::value_type>;
+    using KeysetT = decltype(make_hash_keyset<Engine>(builder));
+    return atomic_hash_map<KeysetT, ValueT>{make_hash_keyset<Engine>(builder),
+                                            values.begin(), values.end()};
+}
+
+template <typename Engine = pext_hash_engine>
+static consteval auto
+make_atomic_hash_valueset(comp_time auto builder) noexcept {
+    constexpr auto values = builder();
+    static constexpr auto keyset = make_hash_keyset<Engine>(builder);
+    using ValueStorT = decltype(lookup::detail::get_values(values));
+    using ValueT = std::remove_cv_t<typename ValueStorT::value_type>;
+    return atomic_hash_map_valueset<decltype(keyset), ValueT>{
+        keyset, values.begin(), values.end()};
+}
+
+/* Over a keyset with static storage duration, as the valueset refers to it */
+template <typename KeysetT, typename ValueT>
+static consteval auto make_atomic_hash_valueset(
+    const KeysetT &keyset,
+    const std::array<std::pair<typename KeysetT::key_type, ValueT>,
+                     KeysetT::keyset_size_v> &items) noexcept {
+    return atomic_hash_map_valueset<KeysetT, ValueT>{keyset, items.begin(),
+                                                     items.end()};
+}
+
+template <typename ValueT, typename KeysetT>
+static consteval auto
+make_atomic_hash_valueset(const KeysetT &keyset) noexcept {
+    return atomic_hash_map_valueset<KeysetT, ValueT>{keyset};
+}
+
 } // namespace heurohash
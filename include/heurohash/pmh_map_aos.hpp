@@ -0,0 +1,240 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "detail/pmh_common.hpp"
+#include "detail/pseudo_pext_lookup.hpp"
+#include "detail/traits.hpp"
+#include "kvp_ptr_iterator.hpp"
+#include "pmh_map_span.hpp"
+
+/*
+ * Hash map with keys & values interleaved in a single array, ordered by
+ * bucket (AoS). hash_map keeps keys (keyset) & values in separate arrays, so
+ * a hit touches the LUT, a key line & a value line - here it is the LUT & a
+ * single entry. Worth it for small values (ints, enums, pointers).
+ *
+ * Iteration & spans step over the entries by their byte size, which is not
+ * possible at compile time (lookups are).
+ */
+
+namespace heurohash {
+namespace detail {
+/* Entries in bucket order, plus a default one past the end so that a failed
+ * lookup (index Size) still points to a value - the same one as end() */
+template <typename EntryT, size_t Size> struct kv_entry_storage {
+    using value_type = EntryT;
+
+    std::array<EntryT, Size + 1> entries{};
+
+    constexpr size_t size() const noexcept { return Size; }
+
+    constexpr EntryT &operator[](size_t idx) noexcept { return entries[idx]; }
+
+    constexpr const EntryT &operator[](size_t idx) const noexcept {
+        return entries[idx];
+    }
+
+    constexpr EntryT *data() noexcept { return entries.data(); }
+
+    constexpr const EntryT *data() const noexcept { return entries.data(); }
+};
+} // namespace detail
+
+template <typename KeyT, typename ValueT, size_t Size, size_t LutSize,
+          size_t Depth, typename LutT>
+class hash_map_aos {
+    using EntryT = lookup::detail::kv_entry<std::remove_cv_t<KeyT>, ValueT>;
+    using LookupT =
+        lookup::pseudo_next_indirect<detail::kv_entry_storage<EntryT, Size>,
+                                     LutT, Depth>;
+
+    LookupT storage;
+
+    static constexpr auto stride = static_cast<std::ptrdiff_t>(sizeof(EntryT));
+
+  public:
+    static constexpr size_t keyset_size_v = Size;
+    static constexpr size_t keyset_lut_size_v = LutSize;
+    static constexpr size_t keyset_depth_v = Depth;
+
+    using key_type = KeyT;
+    using mapped_type = ValueT;
+    using value_type = ValueT;
+    using pair_type = std::pair<key_type, value_type>;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+    using pointer = value_type *;
+    using const_pointer = const value_type *;
+    using iterator = kvp_ptr_iterator<key_type, ValueT>;
+    using const_iterator = kvp_ptr_iterator<key_type, const ValueT>;
+    using entry_type = EntryT;
+
+    consteval hash_map_aos(LookupT stor) noexcept : storage(stor) {}
+
+    constexpr hash_map_aos(const hash_map_aos &) noexcept = default;
+    constexpr hash_map_aos &operator=(const hash_map_aos &) noexcept = default;
+
+    constexpr hash_map_aos(hash_map_aos &&) noexcept = default;
+    constexpr hash_map_aos &operator=(hash_map_aos &&) noexcept = default;
+
+    constexpr ValueT *find(const key_type &key) noexcept {
+        return &storage.key_storage[storage.lookup(key)].value;
+    }
+
+    constexpr const ValueT *find(const key_type &key) const noexcept {
+        return &storage.key_storage[storage.lookup(key)].value;
+    }
+
+    /* Batched find, out[i] = find(in[i]) (i.e. end() if not found) */
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<ValueT *> out) noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        storage.lookup_many(in.data(), in.size(), [&](size_t i, size_t idx) {
+            out[i] = &storage.key_storage[idx].value;
+        });
+    }
+
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<const ValueT *> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        storage.lookup_many(in.data(), in.size(), [&](size_t i, size_t idx) {
+            out[i] = &storage.key_storage[idx].value;
+        });
+    }
+
+    constexpr ValueT &operator[](const key_type &key) noexcept {
+        return *find(key);
+    }
+
+    constexpr ValueT const &operator[](const key_type &key) const noexcept {
+        return *find(key);
+    }
+
+    constexpr ValueT &at(const key_type &key) noexcept {
+        auto idx = storage.lookup(key);
+        constexpr_assert(idx != Size, "Key not found");
+        return storage.key_storage[idx].value;
+    }
+
+    constexpr ValueT const &at(const key_type &key) const noexcept {
+        auto idx = storage.lookup(key);
+        constexpr_assert(idx != Size, "Key not found");
+        return storage.key_storage[idx].value;
+    }
+
+    constexpr size_type count(const key_type &key) const noexcept {
+        return contains(key) ? 1 : 0;
+    }
+
+    constexpr bool contains(const key_type &key) const noexcept {
+        return storage.lookup(key) != Size;
+    }
+
+    /* Capacity */
+    constexpr bool empty() const noexcept { return Size == 0; }
+
+    constexpr size_t size() const noexcept { return Size; }
+
+    constexpr size_t max_size() const noexcept { return Size; }
+
+    /* Iterators */
+    constexpr iterator begin() noexcept {
+        auto &first = storage.key_storage[0];
+        return iterator{&first.key, &first.value, stride};
+    }
+
+    constexpr const_iterator begin() const noexcept {
+        auto const &first = storage.key_storage[0];
+        return const_iterator{&first.key, &first.value, stride};
+    }
+
+    constexpr iterator end() noexcept {
+        auto &last = storage.key_storage[Size];
+        return iterator{&last.key, &last.value, stride};
+    }
+
+    constexpr const_iterator end() const noexcept {
+        auto const &last = storage.key_storage[Size];
+        return const_iterator{&last.key, &last.value, stride};
+    }
+
+    constexpr void clear() noexcept {
+        for (auto i = size_t{0}; i < Size; ++i) {
+            storage.key_storage[i].value = ValueT{};
+        }
+    }
+
+    constexpr operator hash_map_span<KeyT, ValueT>() noexcept {
+        return to_span();
+    }
+
+    constexpr operator hash_map_span<KeyT, const ValueT>() const noexcept {
+        return to_span();
+    }
+
+    constexpr hash_map_span<KeyT, ValueT> to_span() noexcept {
+        return hash_map_span<KeyT, ValueT>{
+            &storage, &storage.key_storage[0].value, stride};
+    }
+
+    constexpr hash_map_span<KeyT, const ValueT> to_span() const noexcept {
+        return hash_map_span<KeyT, const ValueT>{
+            &storage, &storage.key_storage[0].value, stride};
+    }
+};
+
+/* Same engines as make_hash_map, though only the pext one (any policy) */
+template <typename Engine = pext_hash_engine>
+static consteval auto make_hash_aos_map(comp_time auto builder) noexcept {
+    static_assert(!std::is_same_v<Engine, pilot_hash_engine>,
+                  "AoS layout is only supported by the pext engine");
+
+    constexpr auto values = builder();
+    static_assert(lookup::detail::is_arr_kvp(values));
+    static_assert(!detail::is_string_key_v<typename decltype(
+                      lookup::detail::get_orig_keys(values))::value_type>,
+                  "AoS layout doesn't support string keys");
+    using ValueStorT = decltype(lookup::detail::get_values(values));
+    using ValueT = std::remove_cv_t<typename ValueStorT::value_type>;
+
+    constexpr auto search_len =
+        Engine::search_policy::max_search_len(builder());
+    constexpr auto data =
+        lookup::pseudo_pext_lookup<search_len, typename Engine::lut_policy>::
+            make(builder);
+    using data_t = decltype(data);
+    using KeyT = typename data_t::key_type;
+
+    using EntryT = lookup::detail::kv_entry<KeyT, ValueT>;
+    auto entries = detail::kv_entry_storage<EntryT, data.size()>{};
+    for (auto const &kvp : values) {
+        auto const idx = data.lookup(kvp.first);
+        entries[idx] = EntryT{data.key_storage[idx], kvp.second};
+    }
+
+    using LookupT =
+        lookup::pseudo_next_indirect<decltype(entries),
+                                     typename data_t::lut_type, data.depth()>;
+    return hash_map_aos<KeyT, ValueT, data.size(), data.lut_size(),
+                        data.depth(), typename data_t::lut_type>{
+        LookupT{entries, data.lookup_table, data.pext_func}};
+}
+
+static constexpr auto aos_mp = make_hash_aos_map([]() consteval {
+    return std::array{std::pair{1, 'a'}, std::pair{2, 'b'}, std::pair{3, 'c'}};
+});
+static_assert(aos_mp.size() == 3);
+static_assert(aos_mp.at(1) == 'a');
+static_assert(aos_mp[3] == 'c');
+static_assert(aos_mp.contains(2));
+static_assert(!aos_mp.contains(8221));
+static_assert(sizeof(decltype(aos_mp)::entry_type) == 8);
+
+}; // namespace heurohash
@@ -3,27 +3,27 @@
 #include <algorithm>
 #include <cstddef>
 #include <functional>
+#include <span>
+#include <tuple>
 #include <utility>
 
+#include "detail/pmh_common.hpp"
 #include "detail/pseudo_pext_lookup.hpp"
 #include "detail/traits.hpp"
+#include "detail/weights.hpp"
+#include "pmh_map_pilot_keyset.hpp"
+#include "pmh_map_string_keyset.hpp"
 
 /* FIXME: Allow passing custom hashers? */
 
 namespace heurohash {
-namespace detail {
-static constexpr inline size_t hash_map_pnext_depth = 2;
-template <typename KeyT, size_t Size, size_t LutSize, size_t Depth>
-using pseudo_next_t = lookup::pseudo_next_indirect<
-    std::array<KeyT, Size>, std::array<lookup::lookup_idx_exp_t<Size>, LutSize>,
-    Depth>;
-} // namespace detail
-template <typename KeyT, size_t Size, size_t LutSize, size_t Depth>
+template <typename KeyT, size_t Size, size_t LutSize, size_t Depth,
+          typename LutT = std::array<lookup::lookup_idx_exp_t<Size>, LutSize>>
 class hash_map_keyset {
     using KeyUnderlyingT = detail::underlying_type<KeyT>;
     using KeyValT = std::remove_cv_t<KeyT>;
     using KeyStorageT = std::remove_cv_t<std::array<KeyValT, Size>>;
-    using LookupT = detail::pseudo_next_t<KeyT, Size, LutSize, Depth>;
+    using LookupT = detail::pseudo_next_t<KeyT, Size, LutSize, Depth, LutT>;
 
     LookupT storage;
 
@@ -62,8 +62,29 @@ class hash_map_keyset {
         return find_impl(key);
     }
 
+    /* Batched find, out[i] = find(in[i]) */
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<value_type> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        find_many_impl(in, [&](size_t i, size_t idx) { out[i] = idx; });
+    }
+
+    /* Calls emit(input_idx, found_idx) for every key in input */
+    template <typename Func>
+    constexpr void find_many_impl(std::span<const key_type> in,
+                                  Func &&emit) const noexcept {
+        storage.lookup_many(in.data(), in.size(), std::forward<Func>(emit));
+    }
+
+    /* Lookup parameters for spans, if the LUT is dense */
+    constexpr auto span_lookup() const noexcept
+        requires requires(const LookupT &lookup) { lookup.span_lookup(); }
+    {
+        return storage.span_lookup();
+    }
+
     constexpr size_type count(const key_type &key) const noexcept {
-        return contains() ? 1 : 0;
+        return contains(key) ? 1 : 0;
     }
 
     constexpr bool contains(const key_type &key) const noexcept {
@@ -98,24 +119,61 @@ template <typename KeyT, size_t Size, size_t LutSize, size_t Depth>
 hash_map_keyset(detail::pseudo_next_t<KeyT, Size, LutSize, Depth>)
     -> hash_map_keyset<KeyT, Size, LutSize, Depth>;
 
-static consteval auto make_hash_keyset(comp_time auto builder) noexcept {
+template <typename LutPolicy = lookup::dense_lut_policy,
+          typename SearchPolicy =
+              lookup::fixed_search_len<detail::hash_map_pnext_depth>>
+static consteval auto
+make_hash_integral_keyset(comp_time auto builder) noexcept {
     // using builder_ret_t = decltype(lookup::detail::get_orig_keys(builder()));
 
     /* FIXME: This forces us back to C++23. Also full struct might be stored in
      * binary?  */
     // static constexpr auto static_stor_backing =
     //     lookup::pseudo_pext_lookup<detail::hash_map_pnext_depth>::make(builder);
+    constexpr auto search_len = SearchPolicy::max_search_len(builder());
     constexpr auto data =
-        lookup::pseudo_pext_lookup<detail::hash_map_pnext_depth>::make(builder);
+        lookup::pseudo_pext_lookup<search_len, LutPolicy>::make(builder);
     using data_t = decltype(data);
     return hash_map_keyset<typename data_t::key_type, data.size(),
-                           data.lut_size(), data.depth()>{data};
+                           data.lut_size(), data.depth(),
+                           typename data_t::lut_type>{data};
 
     // return hash_map_keyset<typename builder_ret_t::value_type,
     //                        std::tuple_size_v<builder_ret_t>>{
     //     static_stor_backing.to_dyn_lut()};
 }
 
+/* Engine picks the lookup implementation (see detail/pmh_common.hpp) */
+template <typename Engine = pext_hash_engine>
+static consteval auto make_hash_keyset(comp_time auto builder) noexcept {
+    using builder_key_t =
+        typename decltype(lookup::detail::get_orig_keys(builder()))::value_type;
+    if constexpr (std::is_same_v<Engine, pilot_hash_engine>) {
+        static_assert(!detail::is_string_key_v<builder_key_t>,
+                      "String keys are only supported by the pext engine");
+        return make_hash_pilot_keyset(builder);
+    } else if constexpr (detail::is_string_key_v<builder_key_t>) {
+        return make_hash_string_keyset<typename Engine::lut_policy,
+                                       typename Engine::search_policy>(
+            builder);
+    } else {
+        return make_hash_integral_keyset<typename Engine::lut_policy,
+                                         typename Engine::search_policy>(
+            builder);
+    }
+}
+
+/* Keyset with every bucket ordered hottest key first (per the weights
+ * builder's {key, weight} table, see frequency_recorder), so the common
+ * lookups hit on the first probe */
+template <typename Engine = pext_hash_engine>
+static consteval auto
+make_weighted_hash_keyset(comp_time auto builder,
+                          comp_time auto weights) noexcept {
+    return make_hash_keyset<Engine>(
+        detail::weighted_builder<decltype(builder), decltype(weights)>{});
+}
+
 static constexpr auto kst =
     make_hash_keyset([]() consteval { return std::array{1, 2, 3}; });
 static_assert(kst.size() == 3);
@@ -125,4 +183,131 @@ static_assert(kst.find(3) == 1);
 static_assert(kst.find(5) == 3);
 static_assert(kst.find(8221) == 3);
 
+static constexpr auto rank_kst = make_hash_keyset<rank_pext_hash_engine>(
+    []() consteval { return std::array{1, 2, 3}; });
+static_assert(rank_kst.find(1) == kst.find(1));
+static_assert(rank_kst.find(3) == kst.find(3));
+static_assert(rank_kst.find(8221) == 3);
+
+/* Bit packed LUT entries still map every key to its own slot */
+static constexpr auto bit_packed_kst =
+    make_hash_keyset<packed_pext_hash_engine>(
+        []() consteval { return std::array{1, 2, 3, 40, 500, 6000}; });
+static_assert([] {
+    std::array<bool, 6> seen{};
+    for (auto key : {1, 2, 3, 40, 500, 6000}) {
+        auto idx = bit_packed_kst.find(key);
+        if (idx >= seen.size() || seen[idx]) {
+            return false;
+        }
+        seen[idx] = true;
+    }
+    return true;
+}());
+static_assert(bit_packed_kst.find(7) == 6);
+static_assert(bit_packed_kst.find(8221) == 6);
+
+/* A single key packs its LUT entries into 0 bits */
+static constexpr auto bit_packed_single_kst =
+    make_hash_keyset<packed_pext_hash_engine>(
+        []() consteval { return std::array{42}; });
+static_assert(bit_packed_single_kst.find(42) == 0);
+static_assert(bit_packed_single_kst.find(7) == 1);
+
+/* Tuple-like keys are packed member-wise, so unlike plain integrals they
+ * can't be compared straight from memory by the vector probe */
+static_assert(lookup::detail::raw_is_object_bytes_v<std::uint32_t>);
+static_assert(!lookup::detail::raw_is_object_bytes_v<
+              std::tuple<std::uint16_t, std::uint16_t>>);
+static_assert(!lookup::detail::raw_is_object_bytes_v<
+              std::pair<std::uint8_t, std::uint32_t>>);
+
+static constexpr auto tuple_kst =
+    make_hash_keyset<tuned_pext_hash_engine<lookup::fixed_search_len<4>>>(
+        []() consteval {
+            using key_t = std::tuple<std::uint16_t, std::uint16_t>;
+            std::array<key_t, 64> keys{};
+            for (auto i = 0; i < 64; ++i) {
+                keys[i] = key_t{static_cast<std::uint16_t>(i * 7),
+                                static_cast<std::uint16_t>(i * 13 + 1)};
+            }
+            return keys;
+        });
+static_assert(tuple_kst.contains({0, 1}));
+static_assert(tuple_kst.contains({63 * 7, 63 * 13 + 1}));
+static_assert(!tuple_kst.contains({1, 0}));
+
+/* Keys sharing a bucket are stored heaviest first: the builder lists the
+ * lightest keys first & the weights reverse that. Also checks that some
+ * bucket holds keys of different weights, so the order is actually tested */
+static constexpr auto weighted_kst_keys = [] {
+    std::array<int, 48> keys{};
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = static_cast<int>(i * i * 3);
+    }
+    return keys;
+};
+static constexpr auto weighted_kst_weights = [] {
+    std::array<std::pair<int, int>, 40> weights{};
+    for (size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = {static_cast<int>(i * i * 3), static_cast<int>(i + 1)};
+    }
+    return weights;
+};
+static constexpr auto weighted_kst =
+    make_weighted_hash_keyset(weighted_kst_keys, weighted_kst_weights);
+static_assert([] {
+    auto const lookup = weighted_kst.span_lookup();
+    auto const weights = detail::sorted_weights(weighted_kst_weights());
+    auto const keys = weighted_kst.begin();
+    bool tested = false;
+    for (size_t i = 0; i < weighted_kst.size(); ++i) {
+        if (weighted_kst.find(keys[i]) != i) {
+            return false;
+        }
+        for (size_t j = i + 1; j < weighted_kst.size(); ++j) {
+            if (lookup.pext_func(keys[i]) != lookup.pext_func(keys[j])) {
+                continue;
+            }
+            auto const first = detail::weight_of(keys[i], weights);
+            auto const second = detail::weight_of(keys[j], weights);
+            if (first < second) {
+                return false;
+            }
+            tested |= first != second;
+        }
+    }
+    return tested && weighted_kst.find(1) == weighted_kst.size();
+}());
+
+/* Batched lookups match find, for a partial block (lookups go in blocks of
+ * 16) & for two full blocks plus a partial one, every third key a miss */
+template <auto &Keyset, size_t Count>
+consteval bool check_find_many(auto key_of) {
+    std::array<typename std::remove_cvref_t<decltype(Keyset)>::key_type, Count>
+        in{};
+    for (size_t i = 0; i < Count; ++i) {
+        in[i] = key_of(i);
+    }
+    std::array<size_t, Count> out{};
+    Keyset.find_many(in, out);
+    for (size_t i = 0; i < Count; ++i) {
+        auto const missing = i % 3 == 2;
+        if (out[i] != Keyset.find(in[i]) ||
+            (out[i] == Keyset.size()) != missing) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(check_find_many<kst, 5>([](size_t i) {
+    return i % 3 == 2 ? 8221 : static_cast<int>(i % 3 + 1);
+}));
+static_assert(check_find_many<tuple_kst, 37>([](size_t i) {
+    auto j = static_cast<std::uint16_t>(i);
+    return i % 3 == 2 ? std::tuple<std::uint16_t, std::uint16_t>{j, 0}
+                      : std::tuple<std::uint16_t, std::uint16_t>{
+                            j * 7, j * 13 + 1};
+}));
+
 }; // namespace heurohash
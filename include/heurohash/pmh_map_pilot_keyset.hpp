@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
+#include <utility>
+
+#include "detail/pilot_mph_lookup.hpp"
+#include "detail/traits.hpp"
+
+/*
+ * Keyset variant of hash_map_keyset backed by the pilot based minimal perfect
+ * hash (see detail/pilot_mph_lookup.hpp) instead of the pseudo-pext LUT.
+ * Drop-in replacement for hash_map_collection & hash_map_span.
+ */
+
+namespace heurohash {
+template <typename KeyT, size_t Size, size_t Buckets, size_t Spill,
+          size_t Overflow, typename OverflowPilotT>
+class hash_map_pilot_keyset {
+    using KeyValT = std::remove_cv_t<KeyT>;
+    using KeyStorageT = std::array<KeyValT, Size>;
+    using LookupT = lookup::pilot_mph<KeyStorageT, Buckets, Spill, Overflow,
+                                      OverflowPilotT>;
+
+    LookupT storage;
+
+  public:
+    static constexpr size_t keyset_size_v = Size;
+    static constexpr size_t keyset_bucket_count_v = Buckets;
+    static constexpr size_t keyset_spill_size_v = Spill;
+    static constexpr size_t keyset_overflow_size_v = Overflow;
+
+    /* Member types */
+    using key_type = KeyT;
+    using value_type = size_t;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = key_type &;
+    using const_reference = const value_type &;
+    using pointer = value_type *;
+    using const_pointer = const value_type *;
+    using const_iterator = typename KeyStorageT::const_iterator;
+
+    using storage_type = KeyValT;
+
+    consteval hash_map_pilot_keyset(LookupT stor) noexcept : storage(stor) {}
+
+    constexpr hash_map_pilot_keyset(const hash_map_pilot_keyset &) noexcept =
+        default;
+    constexpr hash_map_pilot_keyset &
+    operator=(const hash_map_pilot_keyset &) noexcept = default;
+
+    constexpr hash_map_pilot_keyset(hash_map_pilot_keyset &&) noexcept =
+        default;
+    constexpr hash_map_pilot_keyset &
+    operator=(hash_map_pilot_keyset &&) noexcept = default;
+
+    constexpr value_type find(const key_type &key) const noexcept {
+        return storage.lookup(key);
+    }
+
+    /* Batched find, out[i] = find(in[i]) */
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<value_type> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        find_many_impl(in, [&](size_t i, size_t idx) { out[i] = idx; });
+    }
+
+    /* Calls emit(input_idx, found_idx) for every key in input */
+    template <typename Func>
+    constexpr void find_many_impl(std::span<const key_type> in,
+                                  Func &&emit) const noexcept {
+        storage.lookup_many(in.data(), in.size(), std::forward<Func>(emit));
+    }
+
+    constexpr size_type count(const key_type &key) const noexcept {
+        return contains(key) ? 1 : 0;
+    }
+
+    constexpr bool contains(const key_type &key) const noexcept {
+        return find(key) != Size;
+    }
+
+    /* Capacity */
+    constexpr bool empty() const noexcept { return Size == 0; }
+
+    constexpr size_t size() const noexcept { return Size; }
+
+    constexpr size_t max_size() const noexcept { return Size; }
+
+    constexpr const_iterator begin() const noexcept {
+        return storage.key_storage.cbegin();
+    }
+
+    constexpr const_iterator end() const noexcept {
+        return storage.key_storage.cend();
+    }
+};
+
+static consteval auto make_hash_pilot_keyset(comp_time auto builder) noexcept {
+    constexpr auto data = lookup::pilot_mph_lookup::make(builder);
+    using data_t = decltype(data);
+    return hash_map_pilot_keyset<typename data_t::key_type, data.size(),
+                                 data.bucket_count(), data.spill_size(),
+                                 data.overflow_size(),
+                                 typename data_t::overflow_pilot_type>{data};
+}
+
+static constexpr auto pilot_kst =
+    make_hash_pilot_keyset([]() consteval { return std::array{1, 2, 3}; });
+static_assert(pilot_kst.size() == 3);
+static_assert(pilot_kst.contains(1));
+static_assert(pilot_kst.contains(2));
+static_assert(pilot_kst.contains(3));
+static_assert(!pilot_kst.contains(5));
+static_assert(!pilot_kst.contains(8221));
+
+/* The ~3 bits per key: a pilot byte per 3 keys & a spill entry per 32 */
+static_assert(pilot_kst.keyset_bucket_count_v == 1);
+static_assert(lookup::detail::pilot_bucket_count(300) == 100);
+static_assert(lookup::detail::pilot_spill_size(300) == 10);
+
+}; // namespace heurohash
@@ -4,8 +4,12 @@
 #include <functional>
 #include <memory>
 #include <numeric>
+#include <optional>
+#include <span>
 
 #include "detail/traits.hpp"
+
+#include "atomic_value.hpp"
 #include "kvp_ptr_iterator.hpp"
 #include "pmh_map_keyset.hpp"
 
@@ -18,25 +22,35 @@ class hash_map_collection;
 
 } // namespace detail
 
+template <typename KeyT, typename ValueT, size_t Size, size_t LutSize,
+          size_t Depth, typename LutT>
+class hash_map_aos;
+
+template <typename Engine = pext_hash_engine>
 static consteval auto make_hash_span(comp_time auto builder) noexcept;
 
 /* Span of linear map (aka desized, to allow better 'anonymous' interfaces) */
 template <typename KeyT, typename ValueT> class hash_map_span {
-    /* Need this extra layer of indirection */
-    /* Because LUT element size depends on array size */
-    union PseudoIndirFuncRes {
-        size_t size;
-        const KeyT *key_storage;
-    };
-    enum class PseudoIndirQueryOpt : uint8_t { GetSize = 0, GetStorage = 1 };
-    using PseudoIndirQueryFunc =
-        PseudoIndirFuncRes (*)(const void *ptr, PseudoIndirQueryOpt opt);
+    /* Keyset's find, for keysets without span_lookup() (see
+     * lookup::pseudo_next_span_lookup) */
     using PseudoIndirLookupFunc = size_t (*)(const void *ptr, const KeyT &key);
+    using PseudoIndirLookupManyFunc = void (*)(const void *ptr,
+                                               std::span<const KeyT> in,
+                                               std::span<size_t> out);
+    using DirectLookupT = lookup::pseudo_next_span_lookup<KeyT>;
+    using KeyPtrT = detail::hash_key_ptr_t<KeyT>;
 
     const void *pseudo_indirect_ptr;
-    PseudoIndirQueryFunc pseudo_indirect_query_func;
     PseudoIndirLookupFunc pseudo_indirect_lookup_func;
+    PseudoIndirLookupManyFunc pseudo_indirect_lookup_many_func;
+    /* Inline lookup, if the keyset supports it */
+    std::optional<DirectLookupT> direct_lookup;
+    KeyPtrT key_storage;
+    size_t stor_size;
     ValueT *value_storage;
+    /* Bytes between entries for interleaved key/value storage (hash_map_aos),
+     * 0 for a separate value array */
+    std::ptrdiff_t value_stride;
 
   public:
     /* Member types */
@@ -49,50 +63,60 @@ template <typename KeyT, typename ValueT> class hash_map_span {
     using const_reference = const value_type &;
     using pointer = value_type *;
     using const_pointer = const value_type *;
-    using iterator = kvp_ptr_iterator<KeyT, ValueT>;
-    using const_iterator = kvp_ptr_iterator<KeyT, const ValueT>;
+    using iterator = kvp_ptr_iterator<KeyT, ValueT, KeyPtrT>;
+    using const_iterator = kvp_ptr_iterator<KeyT, const ValueT, KeyPtrT>;
 
   protected:
     template <typename KeysetT, typename Value, bool is_backing>
     friend class detail::hash_map_collection;
 
+    template <typename Engine>
     friend consteval auto make_hash_span(comp_time auto builder) noexcept;
 
+    template <typename Key, typename Value, size_t Size, size_t LutSize,
+              size_t Depth, typename LutT>
+    friend class hash_map_aos;
+
     /* FIXME: This _might_ be not possible at constexpr-time */
     template <typename KeysetT, typename ValueStor>
-    explicit constexpr hash_map_span(const KeysetT *keyset,
-                                     ValueStor *stor_ptr) noexcept
+    explicit constexpr hash_map_span(const KeysetT *keyset, ValueStor *stor_ptr,
+                                     std::ptrdiff_t stride = 0) noexcept
         : pseudo_indirect_ptr{keyset},
-          pseudo_indirect_query_func{
-              [](const void *ptr,
-                 PseudoIndirQueryOpt opt) constexpr -> PseudoIndirFuncRes {
-                  const auto *set = reinterpret_cast<const KeysetT *>(ptr);
-                  switch (opt) {
-                  case PseudoIndirQueryOpt::GetSize: {
-                      return PseudoIndirFuncRes{.size = set->size()};
-                  } break;
-                  case PseudoIndirQueryOpt::GetStorage: {
-                      return PseudoIndirFuncRes{.key_storage = set->begin()};
-                  } break;
-                  default:
-                      std::unreachable();
-                      break;
-                  }
-              }},
           pseudo_indirect_lookup_func{
               [](const void *ptr, const KeyT &key) constexpr {
                   const auto *set = reinterpret_cast<const KeysetT *>(ptr);
                   return set->find(key);
               }},
-          value_storage{stor_ptr} {}
+          pseudo_indirect_lookup_many_func{
+              [](const void *ptr, std::span<const KeyT> in,
+                 std::span<size_t> out) constexpr {
+                  const auto *set = reinterpret_cast<const KeysetT *>(ptr);
+                  set->find_many(in, out);
+              }},
+          direct_lookup{make_direct_lookup(keyset)},
+          key_storage{keyset->begin()}, stor_size{keyset->size()},
+          value_storage{stor_ptr}, value_stride{stride} {}
 
   private:
-    explicit constexpr hash_map_span(const void *ptr,
-                                     PseudoIndirQueryFunc query_func,
-                                     PseudoIndirLookupFunc lookup_func,
-                                     ValueT *val_stor) noexcept
-        : pseudo_indirect_ptr{ptr}, pseudo_indirect_query_func{query_func},
-          pseudo_indirect_lookup_func{lookup_func}, value_storage{val_stor} {}
+    explicit constexpr hash_map_span(
+        const void *ptr, PseudoIndirLookupFunc lookup_func,
+        PseudoIndirLookupManyFunc lookup_many_func,
+        const std::optional<DirectLookupT> &direct, KeyPtrT keys,
+        size_t size, ValueT *val_stor, std::ptrdiff_t stride) noexcept
+        : pseudo_indirect_ptr{ptr}, pseudo_indirect_lookup_func{lookup_func},
+          pseudo_indirect_lookup_many_func{lookup_many_func},
+          direct_lookup{direct}, key_storage{keys}, stor_size{size},
+          value_storage{val_stor}, value_stride{stride} {}
+
+    template <typename KeysetT>
+    static constexpr std::optional<DirectLookupT>
+    make_direct_lookup(const KeysetT *keyset) noexcept {
+        if constexpr (requires { keyset->span_lookup(); }) {
+            return keyset->span_lookup();
+        } else {
+            return std::nullopt;
+        }
+    }
 
   public:
     constexpr hash_map_span(const hash_map_span &) noexcept = default;
@@ -103,13 +127,45 @@ template <typename KeyT, typename ValueT> class hash_map_span {
 
     constexpr operator hash_map_span<KeyT, const ValueT>() const noexcept {
         return hash_map_span<KeyT, const ValueT>{
-            pseudo_indirect_ptr, pseudo_indirect_query_func,
-            pseudo_indirect_lookup_func, value_storage};
+            pseudo_indirect_ptr, pseudo_indirect_lookup_func,
+            pseudo_indirect_lookup_many_func, direct_lookup, key_storage,
+            stor_size, value_storage, value_stride};
     }
 
     /* Lookup */
     constexpr ValueT *find(const KeyT &key) const noexcept {
-        return value_storage + find_impl(key);
+        return value_at(find_impl(key));
+    }
+
+    /* Batched find, out[i] = index of in[i] (size() if not found).
+     * Inline if possible, otherwise a single indirect call for the whole
+     * batch */
+    constexpr void find_many(std::span<const KeyT> in,
+                             std::span<size_t> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        if (direct_lookup) {
+            direct_lookup->lookup_many(
+                in.data(), in.size(),
+                [&](size_t i, size_t idx) { out[i] = idx; });
+            return;
+        }
+        pseudo_indirect_lookup_many_func(pseudo_indirect_ptr, in, out);
+    }
+
+    /* Batched find, out[i] = find(in[i]) */
+    constexpr void find_many(std::span<const KeyT> in,
+                             std::span<ValueT *> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        std::array<size_t, find_many_chunk_size> indices{};
+        for (auto base = std::size_t{0}; base < in.size();
+             base += find_many_chunk_size) {
+            auto const chunk =
+                std::min(find_many_chunk_size, in.size() - base);
+            find_many(in.subspan(base, chunk), std::span{indices}.first(chunk));
+            for (auto i = std::size_t{0}; i < chunk; ++i) {
+                out[base + i] = value_at(indices[i]);
+            }
+        }
     }
 
     /* Faster than going through process checking with end()? */
@@ -118,17 +174,17 @@ template <typename KeyT, typename ValueT> class hash_map_span {
     }
 
     constexpr reference operator[](const KeyT &key) const noexcept {
-        return value_storage[find_impl(key)];
+        return *value_at(find_impl(key));
     }
 
     constexpr reference at(const KeyT &key) const noexcept {
         auto idx = find_impl(key);
         constexpr_assert(idx != size(), "Key not found");
-        return value_storage[find_impl(key)];
+        return *value_at(idx);
     }
 
     constexpr size_type count(const KeyT &key) const noexcept {
-        return contains() ? 1 : 0;
+        return contains(key) ? 1 : 0;
     }
 
     constexpr bool contains(const KeyT &key) const noexcept {
@@ -137,35 +193,46 @@ template <typename KeyT, typename ValueT> class hash_map_span {
 
     constexpr bool empty() const noexcept { return size() == 0; }
 
-    constexpr size_t size() const noexcept {
-        return pseudo_indirect_query_func(pseudo_indirect_ptr,
-                                          PseudoIndirQueryOpt::GetSize)
-            .size;
-    }
+    constexpr size_t size() const noexcept { return stor_size; }
 
     constexpr size_t max_size() const noexcept { return size(); }
 
     constexpr iterator begin() const noexcept {
-        return iterator{get_key_stor(), value_storage};
+        return iterator{key_storage, value_storage, value_stride};
     }
 
     constexpr iterator end() const noexcept {
-        const auto sz = size();
-        return iterator{get_key_stor() + sz, value_storage + sz};
+        return begin() + static_cast<difference_type>(size());
     }
 
     constexpr void clear() noexcept {
-        std::fill(value_storage, value_storage + size(), ValueT{});
+        if (value_stride == 0) {
+            std::fill(value_storage, value_storage + size(), ValueT{});
+            return;
+        }
+        for (auto i = std::size_t{0}; i < size(); ++i) {
+            *value_at(i) = ValueT{};
+        }
     }
 
   private:
-    constexpr auto get_key_stor() const noexcept {
-        return pseudo_indirect_query_func(pseudo_indirect_ptr,
-                                          PseudoIndirQueryOpt::GetStorage)
-            .key_storage;
+    static constexpr size_t find_many_chunk_size = 64;
+
+    constexpr ValueT *value_at(size_t idx) const noexcept {
+        if (value_stride == 0) {
+            return value_storage + idx;
+        }
+        using ByteT =
+            std::conditional_t<std::is_const_v<ValueT>, const char, char>;
+        return reinterpret_cast<ValueT *>(
+            reinterpret_cast<ByteT *>(value_storage) +
+            static_cast<std::ptrdiff_t>(idx) * value_stride);
     }
 
     constexpr size_t find_impl(const KeyT &key) const noexcept {
+        if (direct_lookup) {
+            return direct_lookup->lookup(key);
+        }
         return pseudo_indirect_lookup_func(pseudo_indirect_ptr, key);
     }
 };
@@ -173,13 +240,14 @@ template <typename KeyT, typename ValueT> class hash_map_span {
 /* Hash span generate this way is faster than span generated from
  * existing hash_map - this is because we can re-use the extra
  * type info to choose the compile-time known size variants of lookup */
+template <typename Engine>
 static consteval auto make_hash_span(comp_time auto builder) noexcept {
     constexpr auto values = builder();
     static_assert(lookup::detail::is_arr_kvp(values));
 
     using builder_ret_t = decltype(lookup::detail::get_orig_keys(builder()));
     static constexpr auto static_stor_backing =
-        lookup::pseudo_pext_lookup<detail::hash_map_pnext_depth>::make(builder);
+        make_hash_keyset<Engine>(builder);
     static constexpr auto static_value_backing =
         lookup::detail::get_values(values);
 
@@ -189,4 +257,8 @@ static consteval auto make_hash_span(comp_time auto builder) noexcept {
         &static_stor_backing, static_value_backing.data()};
 }
 
+/* Span of atomic_hash_map/atomic_hash_map_valueset */
+template <typename KeyT, typename ValueT>
+using atomic_hash_map_span = hash_map_span<KeyT, atomic_value<ValueT>>;
+
 }; // namespace heurohash
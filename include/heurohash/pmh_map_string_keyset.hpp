@@ -0,0 +1,276 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include "detail/pmh_common.hpp"
+#include "detail/pseudo_pext_lookup.hpp"
+#include "detail/string_key_iterator.hpp"
+#include "detail/traits.hpp"
+
+/*
+ * String keyed variant of hash_map_keyset.
+ *
+ * Strings are reduced to a 32-bit hash (seed picked at compile-time, so that
+ * all keys get unique hashes) which is then fed to the regular pseudo-pext
+ * lookup. The key characters are stored in a single contiguous pool, which is
+ * used to fully verify the key on a hit (hash match alone doesn't mean that
+ * the key is actually in the set) & for iteration, so the builder's strings
+ * aren't referenced after construction.
+ */
+
+namespace heurohash {
+namespace detail {
+template <typename T>
+inline constexpr bool is_string_key_v =
+    std::is_same_v<std::remove_cv_t<T>, std::string_view>;
+
+/// How hash maps & spans address their keys (string keys are kept in a pool)
+template <typename KeyT>
+using hash_key_ptr_t = std::conditional_t<is_string_key_v<KeyT>,
+                                          string_key_iterator, const KeyT *>;
+
+using string_hash_t = uint32_t;
+
+/// Seeds tried before giving up (each one succeeds with high probability)
+inline constexpr string_hash_t max_string_key_seeds = 1024;
+/// find_string_key_seed result if no seed works
+inline constexpr string_hash_t no_string_key_seed = UINT32_MAX;
+
+/* Seeded FNV-1a with a murmur3 finalizer (so that pext can get away with as
+ * few bits as possible) */
+constexpr string_hash_t string_key_hash(std::string_view str,
+                                        string_hash_t seed) noexcept {
+    string_hash_t hash = 2166136261U ^ seed;
+    for (auto chr : str) {
+        hash ^= static_cast<unsigned char>(chr);
+        hash *= 16777619U;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35U;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+template <size_t Size>
+constexpr auto string_key_hashes(const std::array<std::string_view, Size> &keys,
+                                 string_hash_t seed) {
+    std::array<string_hash_t, Size> hashes{};
+    std::transform(keys.begin(), keys.end(), hashes.begin(),
+                   [&](auto key) { return string_key_hash(key, seed); });
+    return hashes;
+}
+
+template <size_t Size>
+constexpr bool
+string_keys_unique(std::array<std::string_view, Size> keys) noexcept {
+    std::sort(keys.begin(), keys.end());
+    return std::adjacent_find(keys.begin(), keys.end()) == keys.end();
+}
+
+/// Pick the first seed for which all keys have a unique hash
+/// (no_string_key_seed if there is none, e.g. because keys repeat)
+template <size_t Size>
+constexpr string_hash_t
+find_string_key_seed(const std::array<std::string_view, Size> &keys) {
+    if (!string_keys_unique(keys)) {
+        return no_string_key_seed;
+    }
+    for (string_hash_t seed = 0; seed < max_string_key_seeds; ++seed) {
+        if (lookup::detail::keys_are_unique(string_key_hashes(keys, seed))) {
+            return seed;
+        }
+    }
+    return no_string_key_seed;
+}
+
+template <size_t Size>
+constexpr size_t
+string_key_pool_size(const std::array<std::string_view, Size> &keys) {
+    size_t total = 0;
+    for (auto key : keys) {
+        total += key.size();
+    }
+    return total;
+}
+} // namespace detail
+
+template <size_t Size, size_t LutSize, size_t Depth, size_t PoolSize,
+          typename LutT = std::array<lookup::lookup_idx_exp_t<Size>, LutSize>>
+class hash_map_string_keyset {
+    using HashT = detail::string_hash_t;
+    using LookupT = detail::pseudo_next_t<HashT, Size, LutSize, Depth, LutT>;
+
+    LookupT storage;
+    HashT seed;
+    /* Key i is pool[offsets[i], offsets[i + 1]), in lookup order */
+    std::array<char, PoolSize> pool{};
+    std::array<std::uint32_t, Size + 1> offsets{};
+
+  public:
+    static constexpr size_t keyset_size_v = Size;
+    static constexpr size_t keyset_lut_size_v = LutSize;
+    static constexpr size_t keyset_depth_v = Depth;
+
+    /* Member types */
+    using key_type = std::string_view;
+    using value_type = size_t;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = key_type &;
+    using const_reference = const value_type &;
+    using pointer = value_type *;
+    using const_pointer = const value_type *;
+    using const_iterator = detail::string_key_iterator;
+
+    using storage_type = key_type;
+
+    /* input_keys in any order, they get re-ordered to match the lookup */
+    consteval hash_map_string_keyset(
+        LookupT stor, HashT hash_seed,
+        const std::array<std::string_view, Size> &input_keys) noexcept
+        : storage(stor), seed(hash_seed) {
+        auto sorted = input_keys;
+        std::sort(sorted.begin(), sorted.end(), [&](auto lhs, auto rhs) {
+            return detail::string_key_hash(lhs, seed) <
+                   detail::string_key_hash(rhs, seed);
+        });
+
+        size_t pool_pos = 0;
+        for (size_t i = 0; i < Size; ++i) {
+            auto const hash = storage.key_storage[i];
+            auto const key = *std::lower_bound(
+                sorted.begin(), sorted.end(), hash, [&](auto lhs, auto rhs) {
+                    return detail::string_key_hash(lhs, seed) < rhs;
+                });
+            offsets[i] = static_cast<std::uint32_t>(pool_pos);
+            std::copy(key.begin(), key.end(), pool.begin() + pool_pos);
+            pool_pos += key.size();
+        }
+        offsets[Size] = static_cast<std::uint32_t>(pool_pos);
+    }
+
+    constexpr hash_map_string_keyset(const hash_map_string_keyset &) noexcept =
+        default;
+    constexpr hash_map_string_keyset &
+    operator=(const hash_map_string_keyset &) noexcept = default;
+
+    constexpr hash_map_string_keyset(hash_map_string_keyset &&) noexcept =
+        default;
+    constexpr hash_map_string_keyset &
+    operator=(hash_map_string_keyset &&) noexcept = default;
+
+    constexpr value_type find(const key_type &key) const noexcept {
+        return find_impl(key);
+    }
+
+    /* Batched find, out[i] = find(in[i]) */
+    constexpr void find_many(std::span<const key_type> in,
+                             std::span<value_type> out) const noexcept {
+        constexpr_assert(out.size() >= in.size(), "Output span too small");
+        find_many_impl(in, [&](size_t i, size_t idx) { out[i] = idx; });
+    }
+
+    /* Calls emit(input_idx, found_idx) for every key in input */
+    template <typename Func>
+    constexpr void find_many_impl(std::span<const key_type> in,
+                                  Func &&emit) const noexcept {
+        constexpr auto block_size = LookupT::lookup_block_size;
+        std::array<HashT, block_size> hashes{};
+        for (size_t base = 0; base < in.size(); base += block_size) {
+            auto const block = std::min(block_size, in.size() - base);
+            for (size_t i = 0; i < block; ++i) {
+                hashes[i] = detail::string_key_hash(in[base + i], seed);
+            }
+            storage.lookup_many(hashes.data(), block,
+                                [&](size_t i, size_t idx) {
+                                    emit(base + i,
+                                         verify(in[base + i], idx));
+                                });
+        }
+    }
+
+    constexpr size_type count(const key_type &key) const noexcept {
+        return contains(key) ? 1 : 0;
+    }
+
+    constexpr bool contains(const key_type &key) const noexcept {
+        return find_impl(key) != Size;
+    }
+
+    /* Capacity */
+    constexpr bool empty() const noexcept { return Size == 0; }
+
+    constexpr size_t size() const noexcept { return Size; }
+
+    constexpr size_t max_size() const noexcept { return Size; }
+
+    constexpr const_iterator begin() const noexcept {
+        return const_iterator{pool.data(), offsets.data()};
+    }
+
+    constexpr const_iterator end() const noexcept { return begin() + Size; }
+
+  private:
+    constexpr size_t verify(const key_type &key, size_t idx) const noexcept {
+        if (idx == Size) {
+            return Size;
+        }
+        return begin()[static_cast<std::ptrdiff_t>(idx)] == key ? idx : Size;
+    }
+
+    constexpr size_t find_impl(const key_type &key) const noexcept {
+        return verify(key, storage.lookup(detail::string_key_hash(key, seed)));
+    }
+};
+
+template <typename LutPolicy = lookup::dense_lut_policy,
+          typename SearchPolicy =
+              lookup::fixed_search_len<detail::hash_map_pnext_depth>>
+static consteval auto
+make_hash_string_keyset(comp_time auto builder) noexcept {
+    constexpr auto keys = lookup::detail::get_orig_keys(builder());
+    static_assert(detail::is_string_key_v<typename decltype(keys)::value_type>);
+    static_assert(detail::string_keys_unique(keys),
+                  "Lookup keys must be unique.");
+    constexpr auto seed = detail::find_string_key_seed(keys);
+    static_assert(seed != detail::no_string_key_seed,
+                  "No hash seed giving every key a unique hash found");
+    constexpr auto pool_size = detail::string_key_pool_size(keys);
+    static_assert(pool_size <= UINT32_MAX, "String keys too large");
+
+    constexpr auto hashes = []() consteval {
+        return detail::string_key_hashes(
+            lookup::detail::get_orig_keys(decltype(builder){}()), seed);
+    };
+    constexpr auto search_len = SearchPolicy::max_search_len(hashes());
+    constexpr auto data =
+        lookup::pseudo_pext_lookup<search_len, LutPolicy>::make(hashes);
+    using data_t = decltype(data);
+    return hash_map_string_keyset<data.size(), data.lut_size(), data.depth(),
+                                  pool_size, typename data_t::lut_type>{
+        data, seed, keys};
+}
+
+static constexpr auto string_kst = make_hash_string_keyset([]() consteval {
+    return std::array<std::string_view, 3>{"alpha", "beta", "gamma"};
+});
+static_assert(string_kst.size() == 3);
+static_assert(string_kst.contains("alpha"));
+static_assert(string_kst.contains("gamma"));
+static_assert(!string_kst.contains("delta"));
+static_assert(!string_kst.contains("bet"));
+static_assert(!string_kst.contains(""));
+/* Iteration rebuilds the keys from the pool, in lookup order */
+static_assert(string_kst.end() - string_kst.begin() == 3);
+static_assert(string_kst.begin()[string_kst.find("beta")] == "beta");
+static_assert(string_kst.begin()[string_kst.find("gamma")] == "gamma");
+
+}; // namespace heurohash
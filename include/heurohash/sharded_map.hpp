@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+#include "detail/traits.hpp"
+
+#include "atomic_value.hpp"
+
+/*
+ * Counters (or other summed statistics) keyed by the keys of a constexpr map,
+ * updated from many threads. Instead of a single value per key, whose cache
+ * line would bounce between the cores updating it (as would its neighbours'),
+ * each thread adds to its own shard: a cache line aligned copy of the value
+ * array. Shards are only summed on the (slow) read path.
+ */
+
+namespace heurohash {
+namespace detail {
+/// Shard of the calling thread, threads are numbered in order of first use
+inline size_t sharded_thread_id() noexcept {
+    static constinit std::atomic<size_t> next_id{0};
+    thread_local const size_t id =
+        next_id.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+} // namespace detail
+
+/* Map is any constexpr map (linear, ordered or hash map, or a valueset over an
+ * existing keyset), which provides the keys & the initial values. Updates are
+ * relaxed atomic adds to the calling thread's shard - wait-free, and as
+ * threads only share a shard if there are more of them than Shards, mostly
+ * uncontended. Reads (aggregate/snapshot) sum the shards without stopping
+ * writers, so a snapshot isn't a consistent cut across keys */
+template <auto &Map, size_t Shards = 16> class sharded_map {
+    using MapT = std::remove_cvref_t<decltype(Map)>;
+    using ValueT = typename MapT::mapped_type;
+    static_assert(std::is_arithmetic_v<ValueT>,
+                  "sharded_map requires arithmetic values");
+    static_assert(Shards > 0, "sharded_map requires at least one shard");
+
+    static constexpr size_t Size = Map.size();
+
+    /* Padded to whole cache lines, so no two shards share one */
+    struct alignas(detail::cache_line_size) shard {
+        std::array<atomic_value<ValueT>, Size> values{};
+    };
+
+    std::array<shard, Shards> shards{};
+
+  public:
+    using map_type = MapT;
+    using key_type = typename MapT::key_type;
+    using mapped_type = ValueT;
+    using value_type = ValueT;
+    using size_type = size_t;
+
+    static constexpr size_t shard_count = Shards;
+
+    constexpr sharded_map() noexcept = default;
+
+    /* Not copyable, shards are updated in place */
+    sharded_map(const sharded_map &) = delete;
+    sharded_map &operator=(const sharded_map &) = delete;
+
+    /* Adds value to key's counter (in the calling thread's shard), keys not in
+     * Map are ignored */
+    void add(const key_type &key, ValueT value = 1) noexcept {
+        add(key, value, detail::sharded_thread_id());
+    }
+
+    /* Adds value to key's counter in the given shard (modulo Shards), e.g. a
+     * CPU or worker index */
+    constexpr void add(const key_type &key, ValueT value,
+                       size_t shard_idx) noexcept {
+        auto idx = index_of(key);
+        if (idx == Size) {
+            return;
+        }
+        shards[shard_idx % Shards].values[idx].fetch_add(
+            value, std::memory_order_relaxed);
+    }
+
+    /* Map's value for key plus the sum of all shards, ValueT{} if key isn't
+     * in Map */
+    constexpr ValueT aggregate(const key_type &key) const noexcept {
+        auto idx = index_of(key);
+        if (idx == Size) {
+            return ValueT{};
+        }
+        return aggregate_at(idx);
+    }
+
+    /* Copy of Map with the shards summed into its values */
+    constexpr MapT snapshot() const noexcept {
+        MapT map = Map;
+        for (size_t i = 0; i < Size; ++i) {
+            detail::map_value_at(map, i) = aggregate_at(i);
+        }
+        return map;
+    }
+
+    /* Zeroes all shards (i.e. resets to Map's values) */
+    constexpr void clear() noexcept {
+        for (auto &s : shards) {
+            for (auto &value : s.values) {
+                value.store(ValueT{}, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    constexpr bool contains(const key_type &key) const noexcept {
+        return Map.contains(key);
+    }
+
+    constexpr bool empty() const noexcept { return Size == 0; }
+
+    constexpr size_t size() const noexcept { return Size; }
+
+  private:
+    /* Index of key's value in Map, Size if not found */
+    static constexpr size_t index_of(const key_type &key) noexcept {
+        return detail::map_value_index(Map, std::to_address(Map.find(key)));
+    }
+
+    constexpr ValueT aggregate_at(size_t idx) const noexcept {
+        auto sum = detail::map_value_at(Map, idx);
+        for (const auto &s : shards) {
+            sum += s.values[idx].load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+};
+} // namespace heurohash
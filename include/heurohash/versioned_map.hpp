@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "detail/traits.hpp"
+
+/*
+ * Values of a constexpr map (typically a valueset over a keyset in ROM), which
+ * can be replaced as a whole while other threads read them, e.g. config tables
+ * reloaded at run-time. Read-copy-update over two copies of the map: writers
+ * fill the copy no reader uses & publish it with a single pointer store,
+ * readers only load that pointer (acquire) & never wait.
+ *
+ * A replaced copy is reused once every reader has passed a quiescent state
+ * (quiescent-state based reclamation): each reader thread registers a reader,
+ * whose read() result stays valid (a consistent generation of all values)
+ * until it calls quiescent() - e.g. once per event loop iteration.
+ */
+
+namespace heurohash {
+template <auto &Map, size_t MaxReaders = 64> class versioned_map {
+    using MapT = std::remove_cvref_t<decltype(Map)>;
+
+    static constexpr size_t Size = Map.size();
+    /* Generation of readers holding no references */
+    static constexpr std::uint64_t offline_generation = UINT64_MAX;
+
+    struct alignas(detail::cache_line_size) reader_slot {
+        /* Generation the reader was last quiescent in */
+        std::atomic<std::uint64_t> generation{offline_generation};
+        std::atomic<bool> claimed{false};
+    };
+
+    std::array<MapT, 2> buffers{Map, Map};
+    alignas(detail::cache_line_size) std::atomic<const MapT *> current{
+        &buffers[0]};
+    std::atomic<std::uint64_t> current_generation{0};
+    std::mutex writer_mutex;
+    std::array<reader_slot, MaxReaders> readers{};
+
+  public:
+    using map_type = MapT;
+    using key_type = typename MapT::key_type;
+    using mapped_type = typename MapT::mapped_type;
+    using size_type = size_t;
+
+    /* Per thread read handle, see read() & quiescent() */
+    class reader {
+        versioned_map *map;
+        reader_slot *slot;
+
+      public:
+        explicit reader(versioned_map &map) noexcept
+            : map(&map), slot(map.claim_slot()) {
+            online();
+        }
+
+        reader(reader &&other) noexcept
+            : map(other.map), slot(std::exchange(other.slot, nullptr)) {}
+        reader(const reader &) = delete;
+        reader &operator=(const reader &) = delete;
+        reader &operator=(reader &&) = delete;
+
+        ~reader() {
+            if (slot != nullptr) {
+                offline();
+                slot->claimed.store(false, std::memory_order_release);
+            }
+        }
+
+        /* Current values, stay valid until quiescent() or offline() */
+        const MapT &read() const noexcept {
+            return *map->current.load(std::memory_order_acquire);
+        }
+
+        /* Marks that no result of an earlier read() is in use anymore */
+        void quiescent() noexcept {
+            slot->generation.store(
+                map->current_generation.load(std::memory_order_acquire),
+                std::memory_order_release);
+        }
+
+        /* Stops (e.g. before blocking) & resumes reading, writers don't wait
+         * for offline readers */
+        void offline() noexcept {
+            slot->generation.store(offline_generation,
+                                   std::memory_order_release);
+        }
+
+        void online() noexcept {
+            slot->generation.store(
+                map->current_generation.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+            /* Either the writer sees this reader's generation, or this reader
+             * sees the writer's newly published copy */
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    };
+
+    constexpr versioned_map() noexcept = default;
+
+    versioned_map(const versioned_map &) = delete;
+    versioned_map &operator=(const versioned_map &) = delete;
+
+    /* Registers the calling thread as a reader, at most MaxReaders at once */
+    reader register_reader() noexcept { return reader{*this}; }
+
+    /* Number of updates published so far */
+    std::uint64_t generation() const noexcept {
+        return current_generation.load(std::memory_order_acquire);
+    }
+
+    /* Calls modify with a copy of the current values, then publishes the copy
+     * & waits until no reader uses the replaced one. Must not be called from a
+     * thread with an online reader, which would never become quiescent */
+    template <typename F> void update(F &&modify) {
+        std::lock_guard lock{writer_mutex};
+        const auto *old = current.load(std::memory_order_relaxed);
+        auto &next = buffers[old == &buffers[0] ? 1 : 0];
+        copy_values(*old, next);
+        modify(next);
+
+        current.store(&next, std::memory_order_release);
+        auto const next_generation =
+            current_generation.load(std::memory_order_relaxed) + 1;
+        current_generation.store(next_generation, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (auto &slot : readers) {
+            while (slot.generation.load(std::memory_order_acquire) <
+                   next_generation) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /* Publishes values (a map with the same keys, e.g. a copy of read()) */
+    void publish(const MapT &values) {
+        update([&](MapT &next) { copy_values(values, next); });
+    }
+
+  private:
+    /* Value by value, as keys may be interleaved with the values (which can't
+     * be assigned as a whole for valuesets, which refer to their keyset) */
+    static void copy_values(const MapT &from, MapT &to) noexcept {
+        for (size_t i = 0; i < Size; ++i) {
+            detail::map_value_at(to, i) = detail::map_value_at(from, i);
+        }
+    }
+
+    reader_slot *claim_slot() noexcept {
+        for (auto &slot : readers) {
+            if (!slot.claimed.exchange(true, std::memory_order_acquire)) {
+                return &slot;
+            }
+        }
+        constexpr_assert(false, "More than MaxReaders readers");
+        std::terminate();
+    }
+};
+} // namespace heurohash
@@ -0,0 +1,93 @@
+#include <heurohash/atomic_value.hpp>
+#include <heurohash/linear_map.hpp>
+#include <heurohash/ordered_map.hpp>
+#include <heurohash/ordered_map_valueset.hpp>
+#include <heurohash/pmh_map.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace heurohash;
+
+namespace {
+constexpr int thread_count = 8;
+constexpr int adds_per_thread = 10000;
+
+constexpr auto counter_kvps = std::array{
+    std::pair{1u, std::uint64_t{0}}, std::pair{2u, std::uint64_t{5}},
+    std::pair{3u, std::uint64_t{0}}};
+
+constexpr auto hash_counter_kvps = []() consteval { return counter_kvps; };
+
+/* Built at compile time, updated from many threads */
+constinit auto linear_counters = make_atomic_linear_map(counter_kvps);
+constinit auto ordered_counters = make_atomic_ordered_map(counter_kvps);
+constinit auto hash_counters = make_atomic_hash_map(hash_counter_kvps);
+constexpr auto counter_hash_keyset =
+    make_hash_keyset([]() consteval { return std::array{1u, 2u, 3u}; });
+constinit auto hash_valueset_counters =
+    make_atomic_hash_valueset(counter_hash_keyset, counter_kvps);
+
+constexpr auto counter_keyset = make_ordered_keyset(std::array{1u, 2u, 3u});
+constinit auto ordered_valueset_counters =
+    make_atomic_ordered_map_valueset(counter_keyset, counter_kvps);
+
+/* Relaxed adds through the map & a span over it, plus a CAS loop keeping
+ * the largest value seen */
+template <typename MapT, typename SpanT> void concurrent_updates(MapT &map) {
+    SpanT span = map;
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&map, span, t]() {
+            for (auto i = 0; i < adds_per_thread; ++i) {
+                map[1u].fetch_add(1, std::memory_order_relaxed);
+                span.at(2u).fetch_add(2, std::memory_order_relaxed);
+            }
+            auto largest = map.at(3u).load();
+            auto const candidate = static_cast<std::uint64_t>(t * 10);
+            while (largest < candidate &&
+                   !map.at(3u).compare_exchange_weak(largest, candidate)) {
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    HEUROHASH_CHECK(map.at(1u) == thread_count * adds_per_thread);
+    HEUROHASH_CHECK(span.at(2u).load() ==
+                    5 + 2 * thread_count * adds_per_thread);
+    HEUROHASH_CHECK(map.at(3u).load() == (thread_count - 1) * 10);
+    HEUROHASH_CHECK(map.count(3u) == 1);
+    HEUROHASH_CHECK(map.count(4u) == 0);
+    HEUROHASH_CHECK(span.count(1u) == 1 && span.count(0u) == 0);
+
+    map.clear();
+    HEUROHASH_CHECK(map.at(1u) == 0 && map.at(2u) == 0 && map.at(3u) == 0);
+}
+} // namespace
+
+int main() {
+    concurrent_updates<decltype(linear_counters),
+                       atomic_linear_map_span<unsigned, std::uint64_t>>(
+        linear_counters);
+    concurrent_updates<decltype(ordered_counters),
+                       atomic_ordered_map_span<unsigned, std::uint64_t>>(
+        ordered_counters);
+    concurrent_updates<decltype(ordered_valueset_counters),
+                       atomic_ordered_map_span<unsigned, std::uint64_t>>(
+        ordered_valueset_counters);
+    concurrent_updates<decltype(hash_counters),
+                       atomic_hash_map_span<unsigned, std::uint64_t>>(
+        hash_counters);
+    concurrent_updates<decltype(hash_valueset_counters),
+                       atomic_hash_map_span<unsigned, std::uint64_t>>(
+        hash_valueset_counters);
+    return test::failures;
+}
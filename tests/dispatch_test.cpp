@@ -0,0 +1,137 @@
+#include <heurohash/dispatch.hpp>
+#include <heurohash/linear_map.hpp>
+#include <heurohash/ordered_map.hpp>
+#include <heurohash/paged_map.hpp>
+#include <heurohash/pmh_map.hpp>
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include "test_common.hpp"
+
+using namespace heurohash;
+
+namespace {
+/* Keeps the lookups from being constant folded */
+template <typename T> T opaque(T value) {
+    asm volatile("" : "+m"(value));
+    return value;
+}
+
+enum class msg : std::uint16_t { ping = 1, pong = 2, data = 0x500 };
+
+constexpr auto linear = make_linear_map(
+    std::array{std::pair{-1, 10}, std::pair{0, 20}, std::pair{1, 30}});
+
+constexpr auto sparse = make_sparse_linear_map([] {
+    return std::array{std::pair{-70, 10}, std::pair{0, 20},
+                      std::pair{200, 30}};
+});
+
+/* Probing this range slot by slot would take millions of constexpr steps,
+ * the keys are rebuilt from the populated pages instead */
+constexpr auto paged = make_paged_map<8>([] {
+    return std::array{std::pair{0, 10}, std::pair{3'000'000, 20},
+                      std::pair{4'000'000, 30}};
+});
+
+constexpr auto ordered = make_ordered_map(
+    std::array{std::pair{700, 30}, std::pair{5, 10}, std::pair{60, 20}});
+
+constexpr auto hashed = make_hash_map([]() consteval {
+    return std::array{std::pair{msg::ping, 10}, std::pair{msg::pong, 20},
+                      std::pair{msg::data, 30}};
+});
+
+constexpr auto ordered_keys = make_ordered_keyset(std::array{9, 3, 27});
+
+constexpr auto hashed_keys =
+    make_hash_keyset([]() consteval { return std::array{9, 3, 27}; });
+
+constexpr int miss() { return -1; }
+
+constexpr int value_of(int value) { return value; }
+
+template <auto &Map> constexpr int key_of(const auto &key) {
+    return dispatch<Map>(
+        key, [](auto map_key) { return static_cast<int>(map_key.value); },
+        miss);
+}
+
+static_assert(visit<linear>(-1, value_of, miss) == 10);
+static_assert(visit<linear>(1, value_of, miss) == 30);
+static_assert(visit<linear>(2, value_of, miss) == -1);
+static_assert(key_of<linear>(0) == 0);
+
+static_assert(visit<sparse>(-70, value_of, miss) == 10);
+static_assert(visit<sparse>(200, value_of, miss) == 30);
+static_assert(visit<sparse>(1, value_of, miss) == -1);
+static_assert(key_of<sparse>(-70) == -70);
+static_assert(key_of<sparse>(-69) == -1);
+
+static_assert(visit<paged>(3'000'000, value_of, miss) == 20);
+static_assert(visit<paged>(4'000'000, value_of, miss) == 30);
+static_assert(visit<paged>(3'000'001, value_of, miss) == -1);
+static_assert(key_of<paged>(4'000'000) == 4'000'000);
+
+static_assert(visit<ordered>(5, value_of, miss) == 10);
+static_assert(visit<ordered>(700, value_of, miss) == 30);
+static_assert(visit<ordered>(6, value_of, miss) == -1);
+static_assert(key_of<ordered>(60) == 60);
+
+static_assert(visit<hashed>(msg::pong, value_of, miss) == 20);
+static_assert(visit<hashed>(msg::data, value_of, miss) == 30);
+static_assert(visit<hashed>(msg{3}, value_of, miss) == -1);
+static_assert(key_of<hashed>(msg::data) == 0x500);
+
+static_assert(key_of<ordered_keys>(27) == 27);
+static_assert(key_of<ordered_keys>(28) == -1);
+static_assert(key_of<hashed_keys>(3) == 3);
+static_assert(key_of<hashed_keys>(4) == -1);
+
+/* Per key handlers, the rest falls through to the generic one */
+static_assert(dispatch<hashed>(
+                  msg::ping,
+                  overloaded{[](std::integral_constant<msg, msg::ping>) {
+                                 return 1;
+                             },
+                             [](auto) { return 2; }},
+                  miss) == 1);
+static_assert(dispatch<hashed>(
+                  msg::pong,
+                  overloaded{[](std::integral_constant<msg, msg::ping>) {
+                                 return 1;
+                             },
+                             [](auto) { return 2; }},
+                  miss) == 2);
+
+/* Every key of Map (& a miss) dispatched with a run-time key */
+template <auto &Map, size_t Size>
+void check_visit(const std::array<int, Size> &keys,
+                 const std::array<int, Size> &values, int missing) {
+    for (size_t i = 0; i < Size; ++i) {
+        HEUROHASH_CHECK(visit<Map>(opaque(keys[i]), value_of, miss) ==
+                        values[i]);
+    }
+    HEUROHASH_CHECK(visit<Map>(opaque(missing), value_of, miss) == -1);
+
+    int calls = 0;
+    dispatch<Map>(opaque(missing), [&](auto) { ++calls; });
+    HEUROHASH_CHECK(calls == 0);
+}
+} // namespace
+
+int main() {
+    check_visit<linear>(std::array{-1, 0, 1}, std::array{10, 20, 30}, 2);
+    check_visit<sparse>(std::array{-70, 0, 200}, std::array{10, 20, 30}, 199);
+    check_visit<paged>(std::array{0, 3'000'000, 4'000'000},
+                       std::array{10, 20, 30}, 255);
+    check_visit<ordered>(std::array{5, 60, 700}, std::array{10, 20, 30}, 61);
+
+    HEUROHASH_CHECK(visit<hashed>(opaque(msg::data), value_of, miss) == 30);
+    HEUROHASH_CHECK(visit<hashed>(opaque(msg{0}), value_of, miss) == -1);
+    HEUROHASH_CHECK(key_of<hashed_keys>(opaque(9)) == 9);
+    HEUROHASH_CHECK(key_of<ordered_keys>(opaque(10)) == -1);
+    return test::failures;
+}
@@ -0,0 +1,108 @@
+#include <heurohash/frequency_recorder.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "test_common.hpp"
+
+using namespace heurohash;
+
+namespace {
+enum class msg : std::uint8_t { ping = 1, pong = 2 };
+
+void counts() {
+    frequency_recorder<int> recorder;
+    for (int i = 0; i < 3; ++i) {
+        recorder.record(7);
+    }
+    recorder.record(-2);
+    HEUROHASH_CHECK(recorder.count(7) == 3);
+    HEUROHASH_CHECK(recorder.count(-2) == 1);
+    HEUROHASH_CHECK(recorder.count(0) == 0);
+
+    recorder.clear();
+    HEUROHASH_CHECK(recorder.count(7) == 0);
+}
+
+/* Keys in ascending order, signed keys widened to std::int64_t (the smallest
+ * one spelled INT64_MIN) & unsigned ones to std::uint64_t (u suffixed, like
+ * the weights) */
+void dump_signed() {
+    frequency_recorder<std::int64_t> recorder;
+    recorder.record(5);
+    recorder.record(-3);
+    recorder.record(5);
+    recorder.record(std::numeric_limits<std::int64_t>::min());
+
+    std::ostringstream out;
+    recorder.dump(out, "weights");
+    HEUROHASH_CHECK(out.str() ==
+                    "#pragma once\n\n"
+                    "#include <array>\n"
+                    "#include <cstdint>\n"
+                    "#include <utility>\n\n"
+                    "/* Generated by heurohash::frequency_recorder */\n"
+                    "inline constexpr auto weights = [] {\n"
+                    "    return std::array<std::pair<std::int64_t, "
+                    "std::uint64_t>, 3>{{\n"
+                    "        {INT64_MIN, 1u},\n"
+                    "        {-3, 1u},\n"
+                    "        {5, 2u},\n"
+                    "    }};\n"
+                    "};\n");
+}
+
+void dump_enum() {
+    frequency_recorder<msg> recorder;
+    recorder.record(msg::pong);
+    recorder.record(msg::ping);
+    recorder.record(msg::pong);
+
+    std::ostringstream out;
+    recorder.dump(out, "msg_weights");
+    auto const text = out.str();
+    HEUROHASH_CHECK(text.find("inline constexpr auto msg_weights = [] {\n") !=
+                    std::string::npos);
+    HEUROHASH_CHECK(text.find("std::array<std::pair<std::uint64_t, "
+                              "std::uint64_t>, 2>{{\n"
+                              "        {1u, 1u},\n"
+                              "        {2u, 2u},\n"
+                              "    }};\n") != std::string::npos);
+}
+
+/* Keys of 2^63 & up must still be valid literals */
+void dump_unsigned() {
+    frequency_recorder<std::uint64_t> recorder;
+    recorder.record(std::numeric_limits<std::uint64_t>::max());
+    recorder.record(std::uint64_t{1} << 63U);
+    recorder.record(0);
+
+    std::ostringstream out;
+    recorder.dump(out, "weights");
+    HEUROHASH_CHECK(out.str().find("std::uint64_t>, 3>{{\n"
+                                   "        {0u, 1u},\n"
+                                   "        {9223372036854775808u, 1u},\n"
+                                   "        {18446744073709551615u, 1u},\n"
+                                   "    }};\n") != std::string::npos);
+}
+
+/* Nothing recorded still dumps a valid (empty) table */
+void dump_empty() {
+    frequency_recorder<unsigned> recorder;
+    std::ostringstream out;
+    recorder.dump(out, "none");
+    HEUROHASH_CHECK(out.str().find("std::uint64_t>, 0>{{\n    }};\n") !=
+                    std::string::npos);
+}
+} // namespace
+
+int main() {
+    counts();
+    dump_signed();
+    dump_enum();
+    dump_unsigned();
+    dump_empty();
+    return test::failures;
+}
@@ -0,0 +1,70 @@
+#include <heurohash/map_builder.hpp>
+
+#include <array>
+#include <utility>
+
+#include "test_common.hpp"
+
+using namespace heurohash;
+
+namespace {
+/* Keeps the lookups from being constant folded */
+template <typename T> T opaque(T value) {
+    asm volatile("" : "+m"(value));
+    return value;
+}
+
+constexpr auto linear = gen_mixed_map([] {
+    return std::array{std::pair{12, 2}, std::pair{10, 0}, std::pair{11, 1}};
+});
+
+constexpr auto sparse = gen_mixed_map([] {
+    return std::array{std::pair{9, 2}, std::pair{0, 0}, std::pair{5, 1}};
+});
+
+constexpr auto hashed = gen_mixed_map([] {
+    return std::array{std::pair{50000, 2}, std::pair{1, 0},
+                      std::pair{1000, 1}};
+});
+
+/* Ordered (scanned) or hash map, depending on the target's vectors */
+constexpr auto scanned = gen_mixed_map([] {
+    std::array<std::pair<int, int>, 8> kvps{};
+    for (int i = 0; i < 8; ++i) {
+        kvps[i] = {1000 * i, i};
+    }
+    return kvps;
+});
+
+constexpr auto ordered = gen_mixed_map([] {
+    std::array<std::pair<int, int>, 20> kvps{};
+    for (int i = 0; i < 20; ++i) {
+        kvps[i] = {1000 * i, i};
+    }
+    return kvps;
+});
+
+/* Every key maps to its index, the one past the last key to nothing */
+template <auto &Map, size_t Size>
+void check_map(const std::array<int, Size> &keys) {
+    for (size_t i = 0; i < Size; ++i) {
+        HEUROHASH_CHECK(Map.contains(opaque(keys[i])));
+        HEUROHASH_CHECK(Map.at(opaque(keys[i])) == static_cast<int>(i));
+    }
+    HEUROHASH_CHECK(!Map.contains(opaque(keys[Size - 1] + 1)));
+}
+} // namespace
+
+int main() {
+    check_map<linear>(std::array{10, 11, 12});
+    check_map<sparse>(std::array{0, 5, 9});
+    check_map<hashed>(std::array{1, 1000, 50000});
+    check_map<scanned>(
+        std::array{0, 1000, 2000, 3000, 4000, 5000, 6000, 7000});
+    std::array<int, 20> ordered_keys{};
+    for (int i = 0; i < 20; ++i) {
+        ordered_keys[i] = 1000 * i;
+    }
+    check_map<ordered>(ordered_keys);
+    return test::failures;
+}
@@ -0,0 +1,171 @@
+#include <heurohash/ordered_map.hpp>
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include "test_common.hpp"
+
+using namespace heurohash;
+
+namespace {
+/* Keeps the lookups from being constant folded */
+template <typename T> T opaque(T value) {
+    asm volatile("" : "+m"(value));
+    return value;
+}
+
+enum class small_enum : std::uint16_t {};
+
+/* Keys 3 * i + 1, so neighbours of every key are misses */
+template <typename KeyT, size_t Size> consteval auto scan_map() {
+    std::array<std::pair<KeyT, int>, Size> kvps{};
+    for (size_t i = 0; i < Size; ++i) {
+        kvps[i] = {static_cast<KeyT>(3 * (Size - i) - 2),
+                   static_cast<int>(Size - i - 1)};
+    }
+    return ordered_map<KeyT, int, Size>{kvps};
+}
+
+/* Every key (the last ones are found by the clamped tail load) & misses in
+ * between them, below & above */
+template <typename KeyT, size_t Size> void check_scan() {
+    static constexpr auto map = scan_map<KeyT, Size>();
+    for (size_t i = 0; i < Size; ++i) {
+        auto const key = opaque(static_cast<KeyT>(3 * i + 1));
+        HEUROHASH_CHECK(map.contains(key));
+        HEUROHASH_CHECK(map.at(key) == static_cast<int>(i));
+        HEUROHASH_CHECK(!map.contains(static_cast<KeyT>(3 * i + 2)));
+    }
+    HEUROHASH_CHECK(!map.contains(opaque(static_cast<KeyT>(0))));
+    HEUROHASH_CHECK(!map.contains(opaque(static_cast<KeyT>(3 * Size + 1))));
+    HEUROHASH_CHECK(map.find(opaque(static_cast<KeyT>(0))) == map.end());
+}
+
+/* Keys 7 * i - 300, packed into 16 bits */
+constexpr size_t packed_size = 100;
+
+constexpr auto packed_map = make_packed_ordered_map([] {
+    std::array<std::pair<int, int>, packed_size> kvps{};
+    for (size_t i = 0; i < packed_size; ++i) {
+        kvps[i] = {7 * static_cast<int>(i) - 300, static_cast<int>(i)};
+    }
+    return kvps;
+});
+
+/* Only the packed keys are stored, still found, iterated & batch searched */
+void check_packed() {
+    static_assert(sizeof(packed_map) < sizeof(ordered_map<int, int, 100>));
+    std::array<int, packed_size + 2> keys{};
+    for (size_t i = 0; i < packed_size; ++i) {
+        auto const key = opaque(7 * static_cast<int>(i) - 300);
+        keys[i] = key;
+        HEUROHASH_CHECK(packed_map.at(key) == static_cast<int>(i));
+        HEUROHASH_CHECK(!packed_map.contains(key + 1));
+    }
+    keys[packed_size] = opaque(-301);
+    keys[packed_size + 1] = opaque(7 * static_cast<int>(packed_size) - 300);
+    HEUROHASH_CHECK(!packed_map.contains(keys[packed_size]));
+    HEUROHASH_CHECK(!packed_map.contains(keys[packed_size + 1]));
+
+    size_t idx = 0;
+    for (auto const &[key, value] : packed_map) {
+        HEUROHASH_CHECK(key == 7 * static_cast<int>(idx) - 300);
+        HEUROHASH_CHECK(value == static_cast<int>(idx));
+        ++idx;
+    }
+    HEUROHASH_CHECK(idx == packed_size);
+
+    std::array<const int *, packed_size + 2> found{};
+    packed_map.find_many(keys, found);
+    for (size_t i = 0; i < packed_size; ++i) {
+        HEUROHASH_CHECK(*found[i] == static_cast<int>(i));
+    }
+    HEUROHASH_CHECK(found[packed_size] == packed_map.find(-301));
+    HEUROHASH_CHECK(found[packed_size + 1] == packed_map.find(-301));
+
+    std::array<size_t, packed_size + 2> bounds{};
+    packed_map.to_span().lower_bound_many(keys, bounds);
+    for (size_t i = 0; i < packed_size; ++i) {
+        HEUROHASH_CHECK(bounds[i] == i);
+    }
+    HEUROHASH_CHECK(bounds[packed_size] == 0);
+    HEUROHASH_CHECK(bounds[packed_size + 1] == packed_size);
+
+    /* Subspans drop the search index & search the rebuilt keys */
+    auto const sub = packed_map.range(opaque(-1), opaque(100));
+    HEUROHASH_CHECK(sub.size() == 15);
+    HEUROHASH_CHECK(sub.at(opaque(1)) == 43);
+    HEUROHASH_CHECK(!sub.contains(opaque(-6)));
+}
+
+/* Skewed keys 2 * i * i - 5000 */
+template <typename Search> consteval auto learned_map() {
+    std::array<std::pair<int, int>, 500> kvps{};
+    for (int i = 0; i < 500; ++i) {
+        kvps[i] = {2 * i * i - 5000, i};
+    }
+    return ordered_map<int, int, 500, std::less<int>, Search>{kvps};
+}
+
+/* The model's prediction is evaluated at run time here, possibly rounding
+ * differently (e.g. fused multiply-add) */
+template <typename Search> void check_learned() {
+    static constexpr auto map = learned_map<Search>();
+    for (int i = 0; i < 500; ++i) {
+        auto const key = opaque(2 * i * i - 5000);
+        HEUROHASH_CHECK(map.contains(key) && map.at(key) == i);
+        HEUROHASH_CHECK(!map.contains(key + 1));
+    }
+    HEUROHASH_CHECK(!map.contains(opaque(-5001)));
+    HEUROHASH_CHECK(!map.contains(opaque(2 * 500 * 500)));
+}
+
+/* Keys 5 * i, the weights make a few of them hot (checked before the search),
+ * the rest is searched as usual */
+constexpr auto weighted_map = make_weighted_ordered_map(
+    [] {
+        std::array<std::pair<int, int>, 200> kvps{};
+        for (int i = 0; i < 200; ++i) {
+            kvps[i] = {5 * i, i};
+        }
+        return kvps;
+    },
+    [] {
+        return std::array{std::pair{995, 9}, std::pair{0, 7},
+                          std::pair{500, 3}, std::pair{12, 100}};
+    });
+
+void check_weighted() {
+    for (int i = 0; i < 200; ++i) {
+        auto const key = opaque(5 * i);
+        HEUROHASH_CHECK(weighted_map.contains(key) &&
+                        weighted_map.at(key) == i);
+        HEUROHASH_CHECK(!weighted_map.contains(key + 1));
+    }
+    HEUROHASH_CHECK(!weighted_map.contains(opaque(12)));
+    HEUROHASH_CHECK(!weighted_map.contains(opaque(-5)));
+}
+} // namespace
+
+int main() {
+    check_scan<std::int8_t, 16>();
+    check_scan<std::int8_t, 17>();
+    check_scan<std::int8_t, 32>();
+    check_scan<small_enum, 8>();
+    check_scan<small_enum, 13>();
+    check_scan<std::int32_t, 4>();
+    check_scan<std::int32_t, 5>();
+    check_scan<std::int32_t, 11>();
+    check_scan<std::uint32_t, 32>();
+    check_scan<std::int64_t, 2>();
+    check_scan<std::int64_t, 7>();
+    check_scan<std::int64_t, 16>();
+    /* Too few keys for a vector, searched by sorted_search */
+    check_scan<std::int32_t, 3>();
+    check_packed();
+    check_weighted();
+    check_learned<interpolation_search>();
+    check_learned<learned_search<8>>();
+    return test::failures;
+}
@@ -0,0 +1,343 @@
+#include <heurohash/pmh_map.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+#include "test_common.hpp"
+
+using namespace heurohash;
+
+namespace {
+/* 128-bit key without padding, hashed as two 64-bit words */
+struct id128 {
+    std::uint64_t lo;
+    std::uint64_t hi;
+
+    friend constexpr bool operator==(const id128 &, const id128 &) = default;
+};
+using words_key_t = std::array<std::uint64_t, 2>;
+using tuple_key_t = std::tuple<std::uint16_t, std::uint16_t>;
+using pair_key_t = std::pair<std::uint8_t, std::uint32_t>;
+using probe_engine = tuned_pext_hash_engine<lookup::fixed_search_len<4>>;
+
+constexpr tuple_key_t tuple_key(int i) {
+    return {static_cast<std::uint16_t>(i * 7),
+            static_cast<std::uint16_t>(i * 13 + 1)};
+}
+
+constexpr pair_key_t pair_key(int i) {
+    return {static_cast<std::uint8_t>(i * 3),
+            static_cast<std::uint32_t>(i * 1000 + 5)};
+}
+
+/* Keys differ in both words, so the mask has to select bits from each */
+constexpr id128 wide_key(int i) {
+    return {static_cast<std::uint64_t>(i / 8) * 0x9e3779b97f4a7c15U,
+            static_cast<std::uint64_t>(i % 8) << 40U};
+}
+
+constexpr words_key_t words_key(int i) {
+    auto const key = wide_key(i);
+    return {key.hi, key.lo};
+}
+
+constexpr auto wide_map = make_hash_map<probe_engine>([]() consteval {
+    std::array<std::pair<id128, int>, 64> kvps{};
+    for (auto i = 0; i < 64; ++i) {
+        kvps[i] = {wide_key(i), i};
+    }
+    return kvps;
+});
+
+constexpr auto words_map = make_hash_map([]() consteval {
+    std::array<std::pair<words_key_t, int>, 64> kvps{};
+    for (auto i = 0; i < 64; ++i) {
+        kvps[i] = {words_key(i), i};
+    }
+    return kvps;
+});
+
+constexpr auto tuple_map = make_hash_map<probe_engine>([]() consteval {
+    std::array<std::pair<tuple_key_t, int>, 64> kvps{};
+    for (auto i = 0; i < 64; ++i) {
+        kvps[i] = {tuple_key(i), i};
+    }
+    return kvps;
+});
+
+constexpr auto pair_map = make_hash_map<probe_engine>([]() consteval {
+    std::array<std::pair<pair_key_t, int>, 64> kvps{};
+    for (auto i = 0; i < 64; ++i) {
+        kvps[i] = {pair_key(i), i};
+    }
+    return kvps;
+});
+
+constexpr auto int_map = make_hash_map<probe_engine>([]() consteval {
+    std::array<std::pair<std::uint32_t, int>, 64> kvps{};
+    for (auto i = 0; i < 64; ++i) {
+        kvps[i] = {static_cast<std::uint32_t>(i * 977 + 3), i};
+    }
+    return kvps;
+});
+
+constexpr auto string_map = make_hash_map([]() consteval {
+    return std::array<std::pair<std::string_view, int>, 4>{
+        {{"alpha", 1}, {"beta", 2}, {"gamma", 3}, {"", 4}}};
+});
+
+/* 200 pseudo random keys, for the search length policies */
+constexpr auto random_keys = []() consteval {
+    std::array<std::uint32_t, 200> keys{};
+    auto state = std::uint64_t{0x9e3779b97f4a7c15};
+    for (auto &key : keys) {
+        state = state * 6364136223846793005U + 1442695040888963407U;
+        key = static_cast<std::uint32_t>(state >> 32);
+    }
+    return keys;
+};
+
+template <typename SearchPolicy>
+constexpr auto random_kst =
+    make_hash_keyset<tuned_pext_hash_engine<SearchPolicy>>(random_keys);
+
+/* The search length is the worst case number of probes */
+static_assert(random_kst<lookup::min_probes>.keyset_depth_v == 1);
+static_assert(random_kst<lookup::fixed_search_len<2>>.keyset_depth_v <= 2);
+static_assert(random_kst<lookup::fixed_search_len<8>>.keyset_depth_v <= 8);
+static_assert(random_kst<lookup::min_memory<4>>.keyset_depth_v <= 4);
+static_assert(random_kst<lookup::min_memory<4>>.keyset_lut_size_v <=
+              random_kst<lookup::fixed_search_len<4>>.keyset_lut_size_v);
+static_assert(random_kst<lookup::lut_budget<512>>.keyset_lut_size_v <= 512);
+static_assert(random_kst<lookup::lut_budget<512>>.keyset_depth_v <= 8);
+
+/* Single bit keys need a bit each to stay unique (36 here), only a search of
+ * up to 8 probes takes the mask below the 32 bit lookup table limit */
+constexpr auto single_bit_keys = [] {
+    std::array<std::uint64_t, 37> keys{};
+    for (auto i = 0; i < 36; ++i) {
+        keys[i + 1] = std::uint64_t{1} << i;
+    }
+    return keys;
+}();
+static_assert(lookup::detail::mask_popcount(
+                  lookup::detail::calc_base_mask(single_bit_keys)) == 36);
+static_assert(lookup::detail::mask_popcount(std::get<0>(
+                  lookup::detail::calc_pseudo_pext_mask(single_bit_keys,
+                                                        8))) < 32);
+
+/* Keeps the lookups from being constant folded */
+template <typename T> T opaque(T value) {
+    asm volatile("" : "+m"(value));
+    return value;
+}
+
+void composite_keys() {
+    hash_map_span<tuple_key_t, const int> tuple_span = tuple_map;
+    for (auto i = 0; i < 64; ++i) {
+        auto const j = opaque(i);
+        HEUROHASH_CHECK(tuple_map.contains(tuple_key(j)));
+        HEUROHASH_CHECK(tuple_map.at(tuple_key(j)) == i);
+        HEUROHASH_CHECK(tuple_span.contains(tuple_key(j)));
+        HEUROHASH_CHECK(pair_map.contains(pair_key(j)));
+        HEUROHASH_CHECK(pair_map.at(pair_key(j)) == i);
+    }
+    HEUROHASH_CHECK(!tuple_map.contains(opaque(tuple_key_t{1, 0})));
+    HEUROHASH_CHECK(!pair_map.contains(opaque(pair_key_t{1, 0})));
+}
+
+/* Keys wider than 64 bits, through the map, its span & find_many */
+template <auto &Map, typename KeyT>
+void check_wide(KeyT (*key_of)(int), KeyT missing) {
+    hash_map_span<KeyT, const int> span = Map;
+    std::array<KeyT, 21> keys{};
+    for (auto i = 0; i < 64; ++i) {
+        auto const key = opaque(key_of(i));
+        HEUROHASH_CHECK(Map.at(key) == i);
+        HEUROHASH_CHECK(span.at(key) == i);
+        if (i < 21) {
+            keys[i] = i % 3 == 2 ? opaque(missing) : key;
+        }
+    }
+    HEUROHASH_CHECK(!Map.contains(opaque(missing)));
+    HEUROHASH_CHECK(!span.contains(opaque(missing)));
+
+    std::array<const int *, 21> map_values{};
+    std::array<const int *, 21> span_values{};
+    Map.find_many(keys, map_values);
+    span.find_many(keys, span_values);
+    for (auto i = 0; i < 21; ++i) {
+        if (i % 3 == 2) {
+            HEUROHASH_CHECK(map_values[i] == Map.end());
+            HEUROHASH_CHECK(span_values[i] == span.find(keys[i]));
+        } else {
+            HEUROHASH_CHECK(map_values[i] != Map.end() && *map_values[i] == i);
+            HEUROHASH_CHECK(span_values[i] == span.find(keys[i]) &&
+                            *span_values[i] == i);
+        }
+    }
+}
+
+void wide_keys() {
+    check_wide<wide_map>(wide_key, id128{1, 0});
+    check_wide<words_map>(words_key, words_key_t{0, 1});
+}
+
+void integral_keys() {
+    hash_map_span<std::uint32_t, const int> int_span = int_map;
+    for (auto i = 0; i < 64; ++i) {
+        auto const key = opaque(static_cast<std::uint32_t>(i * 977 + 3));
+        HEUROHASH_CHECK(int_map.at(key) == i);
+        HEUROHASH_CHECK(int_span.at(key) == i);
+        HEUROHASH_CHECK(!int_map.contains(key + 1));
+        HEUROHASH_CHECK(!int_span.contains(key + 1));
+    }
+}
+/* Maps batch through their keyset (not the span's inline lookup) */
+void map_find_many() {
+    /* Two full blocks of 16 & a partial one, every third key a miss */
+    std::array<std::uint32_t, 37> keys{};
+    for (auto i = 0; i < 37; ++i) {
+        auto const miss = i % 3 == 2;
+        keys[i] = opaque(static_cast<std::uint32_t>(i * 977 + 3 + miss));
+    }
+    std::array<const int *, 37> values{};
+    int_map.find_many(keys, values);
+    for (auto i = 0; i < 37; ++i) {
+        HEUROHASH_CHECK(values[i] == int_map.find(keys[i]));
+        if (i % 3 != 2) {
+            HEUROHASH_CHECK(*values[i] == i);
+        }
+    }
+
+    /* Partial block only */
+    std::array<tuple_key_t, 5> tuple_keys{tuple_key(3), tuple_key_t{1, 0},
+                                          tuple_key(63), tuple_key(0),
+                                          tuple_key_t{0, 0}};
+    std::array<const int *, 5> tuple_values{};
+    tuple_map.find_many(tuple_keys, tuple_values);
+    HEUROHASH_CHECK(*tuple_values[0] == 3);
+    HEUROHASH_CHECK(tuple_values[1] == tuple_map.end());
+    HEUROHASH_CHECK(*tuple_values[2] == 63);
+    HEUROHASH_CHECK(*tuple_values[3] == 0);
+    HEUROHASH_CHECK(tuple_values[4] == tuple_map.end());
+}
+
+void span_find_many() {
+    hash_map_span<std::uint32_t, const int> int_span = int_map;
+    hash_map_span<tuple_key_t, const int> tuple_span = tuple_map;
+
+    /* One full block of 16 & a partial one, every third key a miss */
+    std::array<std::uint32_t, 21> int_keys{};
+    std::array<tuple_key_t, 21> tuple_keys{};
+    for (auto i = 0; i < 21; ++i) {
+        auto const miss = i % 3 == 2;
+        int_keys[i] = opaque(static_cast<std::uint32_t>(i * 977 + 3 + miss));
+        tuple_keys[i] = opaque(miss ? tuple_key_t{1, 0} : tuple_key(i));
+    }
+
+    std::array<size_t, 21> found{};
+    int_span.find_many(int_keys, found);
+    for (auto i = 0; i < 21; ++i) {
+        if (i % 3 == 2) {
+            HEUROHASH_CHECK(found[i] == int_span.size());
+        } else {
+            HEUROHASH_CHECK((*(int_span.begin() + found[i])).second == i);
+        }
+    }
+
+    std::array<const int *, 21> values{};
+    tuple_span.find_many(tuple_keys, values);
+    for (auto i = 0; i < 21; ++i) {
+        HEUROHASH_CHECK(values[i] == tuple_span.find(tuple_keys[i]));
+        if (i % 3 != 2) {
+            HEUROHASH_CHECK(*values[i] == i);
+        }
+    }
+}
+void string_keys() {
+    /* Keys are rebuilt from the map's own character pool */
+    auto sum = 0;
+    for (auto &&[key, value] : string_map) {
+        HEUROHASH_CHECK(string_map.at(key) == value);
+        sum += value;
+    }
+    HEUROHASH_CHECK(sum == 1 + 2 + 3 + 4);
+
+    hash_map_span<std::string_view, const int> span = string_map;
+    HEUROHASH_CHECK(span.end() - span.begin() == 4);
+    for (auto &&[key, value] : span) {
+        HEUROHASH_CHECK(span.at(key) == value);
+    }
+    HEUROHASH_CHECK(span.at(opaque(std::string_view{"gamma"})) == 3);
+    HEUROHASH_CHECK(!span.contains(opaque(std::string_view{"gamm"})));
+
+    std::array<std::string_view, 3> keys{"beta", "delta", ""};
+    std::array<const int *, 3> values{};
+    span.find_many(keys, values);
+    HEUROHASH_CHECK(*values[0] == 2);
+    HEUROHASH_CHECK(values[1] == span.find("delta"));
+    HEUROHASH_CHECK(*values[2] == 4);
+}
+
+/* Shrunk LUTs still find every key in its own slot */
+template <typename SearchPolicy> void random_lookups() {
+    auto const &kst = random_kst<SearchPolicy>;
+    std::array<bool, 200> seen{};
+    for (auto key : random_keys()) {
+        auto const idx = kst.find(opaque(key));
+        HEUROHASH_CHECK(idx < seen.size() && !seen[idx]);
+        if (idx < seen.size()) {
+            seen[idx] = true;
+        }
+    }
+    HEUROHASH_CHECK(!kst.contains(opaque(std::uint32_t{0})));
+}
+
+void search_policies() {
+    random_lookups<lookup::min_probes>();
+    random_lookups<lookup::fixed_search_len<8>>();
+    random_lookups<lookup::min_memory<4>>();
+    random_lookups<lookup::lut_budget<512>>();
+}
+
+/* Buckets are ordered heaviest key first, lookups (vector probes included)
+ * must still find every key at its own slot */
+void weighted_keys() {
+    static constexpr auto map = make_weighted_hash_map<probe_engine>(
+        []() consteval {
+            std::array<std::pair<std::uint32_t, int>, 64> kvps{};
+            for (auto i = 0; i < 64; ++i) {
+                kvps[i] = {static_cast<std::uint32_t>(i * i * 3), i};
+            }
+            return kvps;
+        },
+        []() consteval {
+            std::array<std::pair<std::uint32_t, int>, 32> weights{};
+            for (auto i = 0; i < 32; ++i) {
+                weights[i] = {static_cast<std::uint32_t>(i * i * 3), i + 1};
+            }
+            return weights;
+        });
+    for (auto i = 0; i < 64; ++i) {
+        auto const key = opaque(static_cast<std::uint32_t>(i * i * 3));
+        HEUROHASH_CHECK(map.contains(key) && map.at(key) == i);
+    }
+    HEUROHASH_CHECK(!map.contains(opaque(std::uint32_t{1})));
+}
+} // namespace
+
+int main() {
+    composite_keys();
+    wide_keys();
+    integral_keys();
+    map_find_many();
+    span_find_many();
+    string_keys();
+    weighted_keys();
+    search_policies();
+    return test::failures;
+}
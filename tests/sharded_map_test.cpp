@@ -0,0 +1,69 @@
+#include <heurohash/pmh_map.hpp>
+#include <heurohash/sharded_map.hpp>
+
+#include <array>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "test_common.hpp"
+
+using namespace heurohash;
+
+namespace {
+constexpr auto counter_kvps = []() consteval {
+    std::array<std::pair<std::uint32_t, std::uint64_t>, 8> kvps{};
+    for (auto i = 0u; i < kvps.size(); ++i) {
+        kvps[i] = {(i + 1) * 100, i};
+    }
+    return kvps;
+};
+
+constexpr auto soa_counters = make_hash_map(counter_kvps);
+/* Keys & values interleaved, values are entry sized apart */
+constexpr auto aos_counters = make_hash_aos_map(counter_kvps);
+
+constinit sharded_map<soa_counters, 4> soa_sharded;
+constinit sharded_map<aos_counters, 4> aos_sharded;
+
+template <typename ShardedT> void concurrent_adds(ShardedT &sharded) {
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < 8; ++t) {
+        threads.emplace_back([&sharded]() {
+            for (auto i = 0; i < 1000; ++i) {
+                sharded.add(200u);
+                sharded.add(800u, 2);
+                sharded.add(12345u); /* ignored */
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    HEUROHASH_CHECK(sharded.aggregate(200u) == 1 + 8000);
+    HEUROHASH_CHECK(sharded.aggregate(800u) == 7 + 16000);
+    HEUROHASH_CHECK(sharded.aggregate(300u) == 2);
+    HEUROHASH_CHECK(sharded.aggregate(12345u) == 0);
+
+    auto const snapshot = sharded.snapshot();
+    HEUROHASH_CHECK(snapshot.at(200u) == 1 + 8000);
+    HEUROHASH_CHECK(snapshot.at(800u) == 7 + 16000);
+    for (auto i = 0u; i < 8; ++i) {
+        auto const key = (i + 1) * 100;
+        if (key != 200 && key != 800) {
+            HEUROHASH_CHECK(snapshot.at(key) == i);
+        }
+    }
+
+    sharded.clear();
+    HEUROHASH_CHECK(sharded.aggregate(200u) == 1);
+}
+} // namespace
+
+int main() {
+    concurrent_adds(soa_sharded);
+    concurrent_adds(aos_sharded);
+    return test::failures;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdio>
+
+/* Minimal checks, the tests are plain executables returning the number of
+ * failed checks */
+namespace heurohash::test {
+inline int failures = 0;
+} // namespace heurohash::test
+
+#define HEUROHASH_CHECK(cond)                                                  \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,        \
+                         __LINE__, #cond);                                     \
+            ++heurohash::test::failures;                                       \
+        }                                                                      \
+    } while (false)
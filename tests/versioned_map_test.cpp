@@ -0,0 +1,100 @@
+#include <heurohash/ordered_map_keyset.hpp>
+#include <heurohash/ordered_map_valueset.hpp>
+#include <heurohash/pmh_map.hpp>
+#include <heurohash/versioned_map.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+#include "test_common.hpp"
+
+using namespace heurohash;
+
+namespace {
+constexpr auto config_kvps = []() consteval {
+    std::array<std::pair<std::uint32_t, int>, 8> kvps{};
+    for (auto i = 0u; i < kvps.size(); ++i) {
+        kvps[i] = {(i + 1) * 100, static_cast<int>(i)};
+    }
+    return kvps;
+};
+
+/* Keys & values interleaved, values are entry sized apart */
+constexpr auto aos_config = make_hash_aos_map(config_kvps);
+constinit versioned_map<aos_config> aos_versioned;
+
+constexpr auto config_keys = make_ordered_keyset(
+    std::array<std::uint32_t, 3>{100, 200, 300});
+/* Refers to config_keys, so it can't be assigned as a whole */
+constexpr auto valueset_config = make_ordered_map_valueset<std::uint32_t, int>(
+    config_keys, {{{100, 1}, {200, 2}, {300, 3}}});
+constinit versioned_map<valueset_config> valueset_versioned;
+
+void interleaved_values() {
+    auto reader = aos_versioned.register_reader();
+    reader.offline();
+
+    aos_versioned.update([](auto &next) {
+        for (auto &&[key, value] : next) {
+            value = static_cast<int>(key);
+        }
+    });
+    /* Copies the previous generation's values as they are */
+    aos_versioned.update([](auto &) {});
+
+    reader.online();
+    for (auto &&[key, value] : reader.read()) {
+        HEUROHASH_CHECK(value == static_cast<int>(key));
+    }
+    HEUROHASH_CHECK(reader.read().at(200u) == 200);
+    HEUROHASH_CHECK(aos_versioned.generation() == 2);
+
+    auto republished = aos_config;
+    republished[800u] = -1;
+    reader.offline();
+    aos_versioned.publish(republished);
+    reader.online();
+    HEUROHASH_CHECK(reader.read().at(800u) == -1);
+    HEUROHASH_CHECK(reader.read().at(100u) == 0);
+}
+
+void concurrent_readers() {
+    std::atomic<bool> running{true};
+    std::atomic<int> torn_reads{0};
+    std::thread reader_thread([&]() {
+        auto reader = valueset_versioned.register_reader();
+        while (running.load(std::memory_order_relaxed)) {
+            auto const &values = reader.read();
+            /* Every update keeps 200 & 300 at 2x & 3x the value of 100 */
+            if (values.at(200u) != 2 * values.at(100u) ||
+                values.at(300u) != 3 * values.at(100u)) {
+                torn_reads.fetch_add(1, std::memory_order_relaxed);
+            }
+            reader.quiescent();
+        }
+    });
+
+    for (auto i = 2; i < 1000; ++i) {
+        valueset_versioned.update([i](auto &next) {
+            next[100u] = i;
+            next[200u] = 2 * i;
+            next[300u] = 3 * i;
+        });
+    }
+    running.store(false, std::memory_order_relaxed);
+    reader_thread.join();
+
+    HEUROHASH_CHECK(torn_reads.load() == 0);
+    auto reader = valueset_versioned.register_reader();
+    HEUROHASH_CHECK(reader.read().at(300u) == 3 * 999);
+}
+} // namespace
+
+int main() {
+    interleaved_values();
+    concurrent_readers();
+    return test::failures;
+}